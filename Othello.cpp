@@ -1,26 +1,158 @@
 // Othello.cpp : Defines the entry point for the console application.
 // hi
 
+#define NO_KEY 0 // Key_control for any key the menus don't use
 #define UP 1
 #define DOWN 2
 #define SELECT 3
 
+#define PASS 64 // square number of a pass for Bit_Board::Make_move
+#define MAX_HISTORY 128 // moves plus passes a game can contain
+#define MAX_PLY 64 // deepest ply the search can reach, one per empty square
+#define NO_MOVE -1
+#define MAX_MOVES 34 // more valid moves than a position can have
+
+#define BOUND_UPPER 1 // stored score is at least the real value
+#define BOUND_LOWER 2 // stored score is at most the real value
+#define BOUND_EXACT 3
+
+#define TT_ALWAYS 0 // replacement policies of Trans_table
+#define TT_DEPTH 1
+#define TT_TWO_TIER 2
+#define TT_DEFAULT_MB 32
+
+#define WIN_SCORE 9000 // finished games score this plus the disc difference
+#define INF_SCORE 10000 // more than any score
+#define ASPIRATION_WINDOW 60
+
+#define TIME_CHECK_NODES 4096 // searches look at the clock once per this many nodes, a power of two
+#define DEFAULT_EBF 4.0 // how much longer an iteration takes than the one before, until measured
+
+#define SOLVED_DEPTH 120 // Trans_table depth of an endgame solver result, deeper than any search
+#define SOLVE_TT_EMPTIES 7 // solver nodes with this many empties use trans_table
+#define SOLVE_SORT_EMPTIES 7 // and order their moves fastest-first, below only by parity
+#define SOLVE_MIN_DEPTH 8 // heuristic iterations done before the solver may take the root over
+#define SOLVE_SECONDS 0.8 // about what solving every move of a root with 18 empties takes
+#define SOLVE_GROWTH 2.5 // and how many times longer each empty more makes it
+#define SOLVE_WLD_SHARE 0.3 // part of that a win / draw / loss solve takes
+#define SOLVE_MARGIN 4 // positions with the same empties differ a lot, the estimate must fit this many times
+
+#define PATTERN_TYPES 8 // shapes scored by Pattern_eval, see pattern_types
+#define PATTERN_INSTANCES 34 // placements of those shapes on the board
+#define PATTERN_MAX_SQUARES 10
+#define PATTERN_LINKS 8 // more pattern instances than one square belongs to
+#define EVAL_STAGES 15 // Pattern_eval weight sets, one per 4 moves of the game
+#define EVAL_WEIGHTS 147584 // weights of one stage: every pattern table, then EVAL_MOBILITY and EVAL_BIAS
+#define EVAL_MOBILITY 147582 // weight of own minus opp valid moves
+#define EVAL_BIAS 147583 // weight added to every position
+#define EVAL_DISC 32 // Pattern_eval scores a disc of final margin as this much
+#define DEFAULT_WEIGHTS_FILE "Othello.weights"
+
+#define SELF_PLAY_SOLVE_EMPTIES 12 // self-play games are solved perfectly from here on, so the margins are right
+#define TUNE_RATE 0.05 // share of its average error a weight moves by per update, more diverges
+#define TUNE_DAMPING 16 // samples a weight counts as having over its real ones, rare weights move less
+#define TUNE_BATCH 262144 // samples the tuner goes over between updates of the weights
+
+#define MPC_STAGES 6 // probcut is fitted separately for each MPC_STAGE_MOVES moves of the game
+#define MPC_STAGE_MOVES 10
+#define MPC_MIN_DEPTH 3 // shallowest remaining depth probcut is tried at
+#define MPC_MAX_DEPTH 14 // deepest one fitted, deeper ones reuse it
+#define MPC_MIN_PAIRS 32 // a stage and depth fitted from fewer positions is not cut at
+#define DEFAULT_PROBCUT_T 1.5 // standard deviations a prediction must miss the window by
+#define DEFAULT_PROBCUT_FILE "Othello.probcut"
+
+#define MATCH_OPENING_PLIES 6 // match games start from every position this many moves in
+#define MATCH_MOVE_SECONDS 0.1 // per move of a match engine given no limit
+#define SPRT_ALPHA 0.05 // chance the sprt accepts elo1 when elo0 is true
+#define SPRT_BETA 0.05 // and the other way around
+#define BENCH_SAMPLES 15 // timed passes of every primitive in Bench_report
+
+#define CHANCE_OUTCOMES 4 // a chance square draws one of these, each as likely, numbered as in Multi_Board::Play_square
+#define CHANCE_GOOD 0 // the square stays the mover's for the rest of the game
+#define CHANCE_BAD 1 // the square goes to the opponent for the rest of the game
+#define CHANCE_STEAL 2 // the mover takes one more square of their choice
+#define CHANCE_NOTHING 3
+#define CHANCE_BOUND (64 * EVAL_DISC) // no chance mode score gets past this either way
+#define CHANCE_WIN (CHANCE_BOUND / 2) // finished games score past this, heuristic scores stay inside
+
+#define DEFAULT_BOOK_FILE "Othello.book"
+#define BOOK_WINDOW 64 // the book builder follows moves scoring this close to the best one
+
 #include <iostream>
 #include <sstream>
 #include <ctime>
 #include <random>
 #include <string>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <fstream>
+#include <unordered_set>
+#include<algorithm>
+#ifdef _WIN32
 #include <windows.h>
 #include <conio.h>
-#include<algorithm>
-
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// the console calls of the game. elsewhere than windows they go through ansi escape
+// codes and termios, so the engine and its tools build and run on linux too
 void Go_to_xy(int x, int y) {
+#ifdef _WIN32
 	HANDLE consoleHandle = GetStdHandle(STD_OUTPUT_HANDLE);
 	COORD pos;
 	pos.X = x;
 	pos.Y = y;
 	SetConsoleCursorPosition(consoleHandle, pos);
+#else
+	std::cout << "\033[" << y + 1 << ";" << x + 1 << "H" << std::flush;
+#endif
+}
+
+void Clear_screen() {
+#ifdef _WIN32
+	system("cls");
+#else
+	std::cout << "\033[2J\033[H" << std::flush;
+#endif
+}
+
+//a key press, without waiting for enter or echoing it
+int Get_key() {
+#ifdef _WIN32
+	return _getch();
+#else
+	termios saved;
+	termios raw;
+	tcgetattr(0, &saved);
+	raw = saved;
+	raw.c_lflag &= ~(ICANON | ECHO);
+	tcsetattr(0, TCSANOW, &raw);
+	int key = getchar();
+	tcsetattr(0, TCSANOW, &saved);
+	return key;
+#endif
+}
+
+#ifndef _WIN32
+void Sleep(unsigned milliseconds) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
 }
+#endif
 
 using namespace std;
 
@@ -39,14 +171,450 @@ public:
 	bool Full_board();
 	bool Has_valid_move(int);
 	void Set_squares(Board* b); //copy over another board's squares
+	void Set_discs(uint64_t black, uint64_t white); //squares from masks, bit (row - 1) * 8 + (col - 1)
 	int Eval(int, int); //heuristic Evaluation of a current board for use in mimimax
 	int Free_neighbors(int, int);
 };
 
+class Pattern_eval;
+
+// the children of a position, made once by Bit_Board::Legal_moves: its moves in row by
+// row order, or PASS alone when only the other side can move, none once the game is over
+struct Move_list {
+	uint64_t mask; // squares of the moves, 0 for a pass or a finished game
+	int count;
+	int list[MAX_MOVES];
+};
+
+// bitboard version of Board used by the ai. bit (row - 1) * 8 + (col - 1) of a mask
+// stands for square (row, col), so bit 0 is the top-left corner and the bits run in
+// the same raster order as the i, j loops of Board.
+class Bit_Board {
+public:
+	uint64_t own; // discs of the side to move
+	uint64_t opp; // discs of the other side
+	int side; // val (1 or -1) of the player whose discs are in own
+	int own_count; // disc counts kept up to date by Make_move / Unmake_move
+	int opp_count;
+	int empties;
+	uint64_t hash; // zobrist key of the position, also kept up to date
+
+	struct Undo_record {
+		uint64_t flips; // discs turned over by the move
+		uint64_t hash; // hash before the move
+		uint16_t pattern[PATTERN_INSTANCES]; // and pattern indices
+		int sq; // square played, PASS for a pass
+	};
+	Undo_record history[MAX_HISTORY]; // moves since the last Set_squares
+	int moves_made;
+
+	Bit_Board();
+	void Set_squares(Board* b, int val); //copy a Board, val moves next
+	void Set_squares(Bit_Board* b); //copies the position only, not the history
+	void Set_discs(uint64_t own_discs, uint64_t opp_discs, int val); //val moves next
+	void Swap(); //hand the move to the other side without playing
+	void Make_move(int sq); //side to move plays sq (must be valid) or PASS
+	void Unmake_move(); //takes back the last Make_move
+	uint64_t Compute_hash(); //hash from scratch, Make_move updates it incrementally
+	uint64_t Discs(int val);
+	uint64_t Moves(int val); //mask of all valid moves for val
+	void Legal_moves(Move_list* moves); //children of the position, a pass included
+	bool Play_square(int, int, int);
+	bool Move_is_valid(int, int, int);
+	int Get_square(int, int);
+	int Score();
+	bool Full_board();
+	bool Has_valid_move(int);
+	int Eval(int, int);
+	int Eval(int cpuval, int depth, Pattern_eval* weights); //with weights in place of pattern_eval
+	int Free_neighbors(int, int);
+
+	uint16_t pattern[PATTERN_INSTANCES]; // base 3 index of each pattern instance, digit 1 for black and 2 for white
+	void Compute_patterns(); //pattern from scratch, Make_move updates it incrementally
+};
+
+inline int Pop_count(uint64_t m) {
+#ifdef _MSC_VER
+	return (int)__popcnt64(m);
+#else
+	return __builtin_popcountll(m);
+#endif
+}
+
+// index of the lowest set bit, m must not be 0
+inline int First_square(uint64_t m) {
+#ifdef _MSC_VER
+	unsigned long i;
+	_BitScanForward64(&i, m);
+	return (int)i;
+#else
+	return __builtin_ctzll(m);
+#endif
+}
+
+uint64_t Get_moves(uint64_t own, uint64_t opp);
+uint64_t Get_flips(uint64_t own, uint64_t opp, int sq);
+uint64_t Get_neighbors(uint64_t m);
+int Touching_pairs(uint64_t m, uint64_t empty);
+int Mask_eval(uint64_t mine, uint64_t theirs);
+
+// the 8 symmetries of the board as mask operations. transform t mirrors the columns
+// if bit 0 is set, then the rows if bit 1 is, then swaps rows and columns if bit 2 is,
+// like Transform_square does for one square
+uint64_t Mirror_columns(uint64_t m);
+uint64_t Mirror_rows(uint64_t m);
+uint64_t Transpose(uint64_t m);
+uint64_t Transform_mask(uint64_t m, int t);
+int Inverse_transform(int t);
+int Canonical_form(uint64_t own, uint64_t opp, uint64_t* canonical_own, uint64_t* canonical_opp);
+
+// weights of the pattern evaluator, one table per pattern type and stage of the game.
+// the file holds them for the side to move (digit 1 own, 2 opp), Load keeps a second
+// copy with the digits swapped so that Score can look up black's absolute indices as
+// they are when white is to move
+class Pattern_eval {
+public:
+	bool Load(const char* path);
+	bool Loaded();
+	int Score(Bit_Board* b); //side to move's point of view, EVAL_DISC per disc
+private:
+	vector<int16_t> weights; // [black / white to move][stage][EVAL_WEIGHTS]
+};
+
+// start of a weights file, followed by EVAL_STAGES * EVAL_WEIGHTS little endian int16s
+struct Weights_header {
+	char magic[4]; // "OPWT"
+	int32_t version;
+	int32_t stages;
+	int32_t weights;
+};
+
+// deep search score ~ a * shallow search score + b, with the error's standard
+// deviation sigma, fitted for one game stage and one depth by Fit_probcut
+struct Probcut_pair {
+	float a;
+	float b;
+	float sigma; // 0 where there were too few samples to fit
+};
+
+// start of a probcut file, followed by MPC_STAGES * (MPC_MAX_DEPTH + 1) Probcut_pairs
+struct Probcut_header {
+	char magic[4]; // "OPMC"
+	int32_t version;
+	int32_t stages;
+	int32_t depths;
+};
+
+// the regressions Try_probcut cuts with, per stage of MPC_STAGE_MOVES moves and per
+// remaining depth. they belong to the weights they were fitted with
+class Probcut {
+public:
+	Probcut();
+	bool Load(const char* path);
+	bool Save(const char* path);
+	bool Loaded() { return loaded; }
+	const Probcut_pair* Get(int empties, int depth, int* shallow); //0 if depth can not be cut
+	Probcut_pair pairs[MPC_STAGES][MPC_MAX_DEPTH + 1]; // [stage][depth], against Probcut_shallow(depth)
+private:
+	bool loaded;
+};
+
+//depth of the search that predicts one of depth: about half, with the same parity
+//since the side to move at the leaves changes how the evaluation errs
+constexpr int Probcut_shallow(int depth) {
+	return depth % 2 + 2 * (depth / 4);
+}
+
+// one position of a self-play game as the sample files hold it, 17 bytes
+#pragma pack(push, 1)
+struct Sample {
+	uint64_t own; // discs of the side to move
+	uint64_t opp;
+	int8_t score; // final disc difference for the side to move
+};
+#pragma pack(pop)
+
+// a whole file mapped read only, so the tuner can go over more samples than fit in
+// memory and leave the paging to the system
+class Mapped_file {
+public:
+	Mapped_file();
+	~Mapped_file();
+	bool Open(const char* path);
+	const char* Data() { return data; }
+	size_t Size() { return size; }
+
+private:
+	const char* data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+};
+
+// one move of a position in the opening book. the book file is a Book_header
+// followed by these, sorted by key and then move, so the moves of a position are
+// next to each other and found by binary search. positions are kept in their
+// Canonical_form, so the symmetric copies of one share its entries
+#pragma pack(push, 1)
+struct Book_entry {
+	uint64_t key; // Book_key of the position
+	uint8_t move; // square in the canonical form
+	int16_t score; // search score of the move for the side to move
+};
+#pragma pack(pop)
+
+struct Book_header {
+	char magic[4]; // "OPBK"
+	int32_t version;
+	int64_t count; // Book_entry records that follow
+};
+
+// the opening book, read where it is mapped. nothing is read before the first
+// lookup, and then only the pages the binary search touches
+class Opening_book {
+public:
+	Opening_book();
+	void Use_file(const char* path); //mapped by the first Lookup
+	bool Lookup(uint64_t key, int* move, int* score); //best move of the position with key
+
+private:
+	bool Map();
+	string path;
+	bool tried; // Map has run, whether it worked or not
+	Mapped_file file;
+	const Book_entry* entries;
+	size_t count;
+};
+
+bool Read_book(const char* path, Mapped_file* file, const Book_entry** entries, size_t* count);
+uint64_t Book_key(uint64_t own, uint64_t opp);
+inline uint64_t Hash_masks(uint64_t own, uint64_t opp);
+
+int Eval_stage(int empties);
+void Get_patterns(uint64_t black, uint64_t white, uint16_t* pattern);
+
+struct Tt_entry {
+	uint64_t key; // full hash, 0 for an empty slot
+	int16_t score; // from the point of view of the side to move
+	int8_t depth; // plies searched below the position
+	int8_t move; // best square or NO_MOVE
+	uint8_t bound;
+	uint8_t age; // Trans_table::age of the search that stored it
+};
+
+// how one searcher used the table. kept by the searcher, not the table, so threads
+// sharing the table do not fight over the counters
+struct Tt_counters {
+	long long probes;
+	long long hits;
+	long long stores;
+	long long collisions; // stores that threw out a different position
+};
+
+// a Tt_entry as the table keeps it: everything but the key packed into data, and
+// key ^ data in check. threads read and write slots without locks, so a slot can end
+// up with check from one store and data from another; check ^ data then no longer
+// gives the probed key and the slot reads as a miss instead of a wrong entry
+struct Tt_slot {
+	atomic<uint64_t> check;
+	atomic<uint64_t> data;
+};
+
+// fixed size hash table of search results, two entries per bucket, safe to share
+// between searching threads
+class Trans_table {
+public:
+	Trans_table();
+	void Resize(int mb); //drops all entries
+	void Clear();
+	void New_search(); //entries of older searches become first to be replaced
+	bool Probe(uint64_t key, Tt_entry* e, Tt_counters* c); //copies the entry into e if found
+	void Store(uint64_t key, int depth, int score, int bound, int move, Tt_counters* c);
+	bool Allocated() { return !entries.empty(); }
+
+	int policy; // TT_ALWAYS, TT_DEPTH or TT_TWO_TIER
+
+private:
+	Tt_entry Load(Tt_slot* slot);
+	void Save(Tt_slot* slot, const Tt_entry& e);
+
+	vector<Tt_slot> entries;
+	uint64_t bucket_mask;
+	uint8_t age;
+};
+
+// state of one ply of the search
+struct Search_frame {
+	Move_list moves; // in the order Order_moves picked
+	int sq; // move being searched
+	int best; // move that produced the returned value
+};
+
+// moves of a solver node handed out to other threads once its first move has been
+// searched (young brothers wait). lives on the stack of the thread that split, which
+// does not return before every handed out move is finished
+struct Split_point {
+	Split_point* parent; // split point the splitting thread was working for, 0 if none
+	uint64_t own;
+	uint64_t opp;
+	int beta;
+	int list[MAX_MOVES]; // the moves still to search
+	int count;
+	atomic<int> pending; // handed out moves that are not finished yet
+
+	mutex lock; // guards the three below
+	int alpha;
+	int best;
+	int best_move;
+	atomic<bool> cutoff; // a move reached beta, the rest need not be searched
+	atomic<bool> timed_out; // a move was given up unfinished, so the result is incomplete
+};
+
+struct Solve_task {
+	Split_point* sp;
+	int n; // index into sp->list
+};
+
+// tasks a thread handed out. it takes them back from the back, idle threads steal
+// from the front
+struct Work_queue {
+	mutex lock;
+	deque<Solve_task> tasks;
+};
+
+class Time_manager;
+
+// counters of a search stack as they stood when one iteration finished. they only
+// grow during a move, so what an iteration cost is the difference to the one before
+struct Iteration_stats {
+	long long nodes;
+	long long cutoffs;
+	long long first_move_cutoffs;
+	long long eval_calls;
+	int score;
+	int pv[MAX_PLY + 1]; // best line of the iteration, starting with its move
+	int pv_length;
+};
+
+// everything a search needs, allocated once and reused by every iteration and move
+// so that searching a node never touches the heap
+struct Search_stack {
+	Bit_Board board; // position being searched, kept current with Make_move / Unmake_move
+	Search_frame frames[MAX_PLY + 1]; // frames[depth] belongs to the node at that depth
+	int maxdepth;
+	bool timed_out; // scores after the time ran out are not stored
+	bool solving; // nodes below the root go to the endgame solver
+	bool solved; // the last finished iteration was a solving one, its score is exact
+	int helpers; // threads searching the same root alongside, they join its solve. 0 alone
+	int id; // thread number, 0 for the main thread
+	Split_point* sp; // split point of the task being solved, 0 outside of one
+	bool cancelled; // the task being solved was cut off, its scores mean nothing
+	Time_manager* clock; // limits of the search, shared by the threads searching one position
+	int depth_limit; // iterative deepening stops after this depth
+	long long node_limit; // and gives up after this many nodes, 0 for no limit
+	Trans_table* table; // trans_table, unless the search must not share it
+	Pattern_eval* eval; // weights the leaves are scored with, pattern_eval unless set
+	double probcut_t; // how sure Try_probcut must be, 0 turns it off
+	void (*report)(Search_stack* s, int depth); // called after every iteration of the main thread, 0 for none. Prepare_search leaves it
+	uint64_t root_exclude; // root moves left out of the search, so a hint can give the next best. Prepare_search leaves it
+
+	// move ordering
+	int killers[MAX_PLY + 1][2]; // last two moves that caused a cutoff at each depth
+	int history[2][64]; // [0] black, [1] white, grows by depth^2 for every cutoff
+	int pv[MAX_PLY + 1][MAX_PLY + 1]; // pv[depth] is the best line found from the node at depth
+	int pv_length[MAX_PLY + 1];
+	int prev_pv[MAX_PLY + 1]; // best line of the last finished iteration
+	int prev_pv_length;
+	bool follow_pv; // the moves so far are the start of prev_pv
+	long long cutoffs;
+	long long first_move_cutoffs; // cutoffs caused by the first move searched
+	long long nodes;
+	long long eval_calls; // leaves scored by Eval
+	Tt_counters tt;
+
+	// result of the last finished iteration
+	int completed_depth;
+	int best_move;
+	int score;
+	double iteration_seconds[MAX_PLY + 1]; // when each iteration finished, -1 if it did not
+	Iteration_stats iterations[MAX_PLY + 1]; // [depth], valid where iteration_seconds is
+};
+
+struct Search_options {
+	int exact_empties; // the endgame solver plays perfectly from this many empties down
+	int wld_empties; // and only tells win / draw / loss apart from this many down to exact_empties + 1
+	int threads; // searching threads, the extra ones share trans_table (lazy smp)
+	int split_empties; // in the endgame they instead take over moves of solver nodes with this many empties
+	int max_depth; // iterative deepening stops after this depth
+	double move_seconds; // longest the computer thinks about one move
+	double game_seconds; // all of its moves of a game together, 0 for no limit
+	long long max_nodes; // nodes each searching thread may visit for a move, 0 for no limit
+	bool ponder; // Play_single searches while the human thinks, see Start_ponder
+	double probcut_t; // standard deviations of Try_probcut, higher is safer and slower, 0 for none
+};
+
+// decides how long Minimax_decision may think, on a monotonic clock
+class Time_manager {
+public:
+	Time_manager();
+	void New_game(); //gives the computer search_options.game_seconds again
+	void Start_move(int empties); //starts the clock and sets the limits of this move
+	void End_move(); //takes the time spent off the game budget
+	double Elapsed(); //seconds since Start_move
+	bool Out_of_time() { return Elapsed() >= hard_limit; }
+	double Remaining() { return hard_limit - Elapsed(); } //seconds until Out_of_time
+	void Start_fixed(double seconds); //starts the clock for a move of exactly seconds, no game budget
+	void Credit(double seconds) { credit = seconds; } //the next move was already searched this long
+	bool Start_iteration(double last, double two_back); //whether one more iteration is worth starting
+
+private:
+	chrono::steady_clock::time_point start;
+	double soft_limit; // no new iteration after this
+	double hard_limit; // searches give up after this
+	double game_left;
+	double credit; // comes off the limits of the next Start_move
+};
 
 pair<int, int> Minimax_decision(Board* b, int cpuval);
-int Max_value(Board* b, int cpuval, int alpha, int beta, int depth, int maxdepth, time_t start);
-int Min_value(Board* b, int cpuval, int alpha, int beta, int depth, int maxdepth, time_t start);
+void Prepare_search(Search_stack* s);
+void Start_ponder(Board* b, int human);
+void Stop_ponder();
+pair<int, int> Ponder_decision(Board* b, int cpuval);
+void Report_search(Search_stack* s, int helpers, int best, int best_depth);
+void Iterative_deepening(Search_stack* s, int id);
+void Smp_report(int threads, int depth, int positions);
+int Number_args(int argc, char* argv[], int i);
+void Self_play(const char* path, int games, int depth, int random_moves);
+void Tune(const char* samples_path, const char* weights_path, int epochs);
+void Fit_probcut(const char* samples_path, int positions, int depth, const char* out_path);
+void Build_book(const char* path, int plies, int depth);
+bool Book_move(Board* b, int cpuval, pair<int, int>* move);
+void Analyze(const char* path, int threads);
+void Perft_report(int depth, const char* position, bool check);
+void Chance_check(int positions, int depth);
+void Bench_report(int positions, const char* path);
+void Match(int games, const string& spec_a, const string& spec_b, bool sprt, double elo0, double elo1, const char* openings_path);
+void Protocol();
+int Negamax(Search_stack* s, int alpha, int beta, int depth);
+int Final_score(Bit_Board* b);
+int Diff_score(int diff);
+int Solve_endgame(Search_stack* s, uint64_t own, uint64_t opp, int alpha, int beta);
+double Solve_estimate(int empties);
+int Solve_split(Search_stack* s, uint64_t own, uint64_t opp, int alpha, int beta, int best, int* best_move, const int* list, int count);
+bool Split_cancelled(Split_point* sp);
+bool Steal_task(Search_stack* s, Split_point* below, Solve_task* t);
+void Run_task(Search_stack* s, Solve_task t);
+bool Probe_table(Search_stack* s, int alpha, int beta, int depth, int* val, int* hash_move);
+bool Try_probcut(Search_stack* s, int alpha, int beta, int depth, int* val);
+void Order_moves(Search_stack* s, int depth, int hash_move);
+void Note_cutoff(Search_stack* s, int depth, int n);
+void Update_pv(Search_stack* s, int depth);
+void Store_result(Search_stack* s, int alpha, int beta, int depth, int val, int move);
+void Exclude_moves(Move_list* moves, uint64_t squares);
 
 Board::Board() {
 	for (int i = 0; i < 8; i++)
@@ -175,129 +743,31 @@ void Board::Set_squares(Board* b) {
 	}
 }
 
-int Board::Eval(int cpuval, int depth) { // originally used score, but it led to bad ai
+void Board::Set_discs(uint64_t black, uint64_t white) {
+	for (int i = 0; i < 8; i++)
+		for (int j = 0; j < 8; j++)
+			squares[i][j] = (black >> (i * 8 + j) & 1) ? 1 : (white >> (i * 8 + j) & 1) ? -1 : 0;
+}
+
+int Board::Eval(int cpuval, int) { // originally used score, but it led to bad ai
 					// instead we Evaluate based maximizing the
 					// difference between computer's available move count
 					// and the player's. Additionally, corners will be
 					// considered as specially beneficial since they cannot ever be
-					// flipped.
-
-	int score = 0; // Evaluation score
-
-	// count available moves for computer and player
-	int mc = 0; int mp = 0;
-	for (int i = 1; i < 9; i++) {
-		for (int j = 1; j < 9; j++) {
-			if (Move_is_valid(i, j, cpuval))
-				mc++;
-			if (Move_is_valid(i, j, -1 * cpuval))
-				mp++;
-		}
-	}
-
-	// add the difference to score (scaled)
-	score += 20 * (mc - mp); // the number is just some scale determined through playing
-	//score += 7*mc;
-
-	/*
-	// additionally, if mp is 0 this is real good so add some more points,
-	// and if mc is 0 this is real bad so subtract more points
-	// because of skipped turns
-
-	if (mp == 0)
-		score += 50;
-	if (mc == 0)
-		score -= 50;
-	*/
-
-	// count corners for computer and player
-	int cc = 0; int cp = 0;
-	if (Get_square(1, 1) == cpuval)
-		cc++;
-	else if (Get_square(1, 1) == -1 * cpuval)
-		cp++;
-
-	if (Get_square(1, 8) == cpuval)
-		cc++;
-	else if (Get_square(1, 8) == -1 * cpuval)
-		cp++;
-
-	if (Get_square(8, 1) == cpuval)
-		cc++;
-	else if (Get_square(8, 1) == -1 * cpuval)
-		cp++;
-
-	if (Get_square(8, 8) == cpuval)
-		cc++;
-	else if (Get_square(8, 8) == -1 * cpuval)
-		cp++;
-
-	// add the difference to score (scaled)
-	score += 200 * (cc - cp);
-
-	/*
-	// squares adjacent to corners on edges also useful, but not as much since it could lead to a corner
-	int ac = 0; int ap = 0;
-	if (Get_square(1, 2) == cpuval)
-		ac++;
-	else if (Get_square(1, 2) == -1*cpuval)
-		ap++;
-	if (Get_square(2, 1) == cpuval)
-		ac++;
-	else if (Get_square(2, 1) == -1*cpuval)
-		ap++;
-
-	if (Get_square(1, 7) == cpuval)
-		ac++;
-	else if (Get_square(1, 7) == -1*cpuval)
-		ap++;
-	if (Get_square(2, 8) == cpuval)
-		ac++;
-	else if (Get_square(2, 8) == -1*cpuval)
-		ap++;
-
-	if (Get_square(7, 1) == cpuval)
-		ac++;
-	else if (Get_square(7, 1) == -1*cpuval)
-		ap++;
-	if (Get_square(8, 2) == cpuval)
-		ac++;
-	else if (Get_square(8, 2) == -1*cpuval)
-		ap++;
-
-	if (Get_square(7, 8) == cpuval)
-		ac++;
-	else if (Get_square(7, 8) == -1*cpuval)
-		ap++;
-	if (Get_square(8, 7) == cpuval)
-		ac++;
-	else if (Get_square(8, 7) == -1*cpuval)
-		ap++;
-
-	score += 30*(ac - ap);
-
-	// scale so bigger depths are worth more
-	score += 10*depth;
-
-	*/
-
-	// limit the amount of space around our pieces so we don't surround as much (which leads to big gains endgame for opponent)
-	int sc = 0; int sp = 0; // counts for open spaces neighboring a player/comp's pieces
-	for (int i = 1; i < 9; i++) {
-		for (int j = 1; j < 9; j++) {
-			if (Get_square(i, j) == cpuval) {
-				//add count to sc
-				sc += Free_neighbors(i, j);
-			}
-			if (Get_square(i, j) == -1 * cpuval) {
-				//add count to sp
-				sp += Free_neighbors(i, j);
-			}
+					// flipped. Open spaces around our pieces count against us
+					// (they lead to big gains endgame for opponent).
+					// The terms come from whole-board mask operations in
+					// Mask_eval instead of walking every square.
+	uint64_t mine = 0;
+	uint64_t theirs = 0;
+	for (int i = 0; i < 8; i++)
+		for (int j = 0; j < 8; j++) {
+			if (squares[i][j] == cpuval)
+				mine |= 1ULL << (i * 8 + j);
+			else if (squares[i][j] != 0)
+				theirs |= 1ULL << (i * 8 + j);
 		}
-	}
-
-	score -= 10 * (sc - sp); // subtract because we are trying to minimize it
-	return score;
+	return Mask_eval(mine, theirs);
 }
 
 int Board::Free_neighbors(int i, int j) {
@@ -325,206 +795,3665 @@ int Board::Free_neighbors(int i, int j) {
 
 }
 
-bool Make_simple_cpu_move(Board* b, int cpuval) {
-	for (int i = 1; i < 9; i++)
-		for (int j = 1; j < 9; j++)
-			if (b->Get_square(i, j) == 0)
-				if (b->Play_square(i, j, cpuval))
-					return true;
-	cout << "Computer passes." << endl;
-	return false;
+// the 8 directions as shift amounts: << dir_shift[d] and >> dir_shift[d].
+// dir_mask[d] drops the columns a run of discs can not wrap around through.
+static const int dir_shift[4] = { 1, 8, 7, 9 };
+static const uint64_t dir_mask[4] = {
+	0x7e7e7e7e7e7e7e7eULL, 0xffffffffffffffffULL, 0x7e7e7e7e7e7e7e7eULL, 0x7e7e7e7e7e7e7e7eULL
+};
+
+//returns mask of every empty square where own flips at least one of opp's discs
+uint64_t Get_moves(uint64_t own, uint64_t opp) {
+	uint64_t moves = 0;
+	for (int d = 0; d < 4; d++) {
+		int s = dir_shift[d];
+		uint64_t o = opp & dir_mask[d];
+		// runs of opp discs starting next to one of own's, at most 6 long
+		uint64_t t = o & (own << s);
+		t |= o & (t << s); t |= o & (t << s); t |= o & (t << s);
+		t |= o & (t << s); t |= o & (t << s);
+		moves |= t << s;
+		t = o & (own >> s);
+		t |= o & (t >> s); t |= o & (t >> s); t |= o & (t >> s);
+		t |= o & (t >> s); t |= o & (t >> s);
+		moves |= t >> s;
+	}
+	return moves & ~(own | opp);
+}
+
+//returns mask of opp's discs flipped when own plays on empty square sq (0 if none)
+uint64_t Get_flips(uint64_t own, uint64_t opp, int sq) {
+	uint64_t flips = 0;
+	uint64_t m = 1ULL << sq;
+	for (int d = 0; d < 4; d++) {
+		int s = dir_shift[d];
+		uint64_t o = opp & dir_mask[d];
+		// run of opp discs going away from sq, kept only if own closes it
+		uint64_t t = o & (m << s);
+		t |= o & (t << s); t |= o & (t << s); t |= o & (t << s);
+		t |= o & (t << s); t |= o & (t << s);
+		flips |= t & (0 - (uint64_t)(((t << s) & own) != 0));
+		t = o & (m >> s);
+		t |= o & (t >> s); t |= o & (t >> s); t |= o & (t >> s);
+		t |= o & (t >> s); t |= o & (t >> s);
+		flips |= t & (0 - (uint64_t)(((t >> s) & own) != 0));
+	}
+	return flips;
+}
+
+//returns mask of the squares touching any square of m
+uint64_t Get_neighbors(uint64_t m) {
+	uint64_t l = (m << 1) & 0xfefefefefefefefeULL; // moved one column right
+	uint64_t r = (m >> 1) & 0x7f7f7f7f7f7f7f7fULL; // moved one column left
+	uint64_t row = m | l | r;
+	return ((row << 8) | (row >> 8) | l | r) & ~m;
+}
+
+//number of (square of m, square of empty) pairs that touch, so Board::Free_neighbors
+//summed over the squares of m. one count per direction instead of one per square.
+int Touching_pairs(uint64_t m, uint64_t empty) {
+	uint64_t l = (m << 1) & 0xfefefefefefefefeULL; // moved one column right
+	uint64_t r = (m >> 1) & 0x7f7f7f7f7f7f7f7fULL; // moved one column left
+	return Pop_count(l & empty) + Pop_count(r & empty)
+		+ Pop_count((m << 8) & empty) + Pop_count((m >> 8) & empty)
+		+ Pop_count((l << 8) & empty) + Pop_count((l >> 8) & empty)
+		+ Pop_count((r << 8) & empty) + Pop_count((r >> 8) & empty);
+}
+
+//the hand terms of Board::Eval for the player with the discs of mine
+int Mask_eval(uint64_t mine, uint64_t theirs) {
+	const uint64_t corners = 0x8100000000000081ULL;
+	uint64_t empty = ~(mine | theirs);
+	int score = 20 * (Pop_count(Get_moves(mine, theirs)) - Pop_count(Get_moves(theirs, mine)));
+	score += 200 * (Pop_count(mine & corners) - Pop_count(theirs & corners));
+	score -= 10 * (Touching_pairs(mine, empty) - Touching_pairs(theirs, empty)); // open spaces neighboring each disc
+	return score;
+}
+
+//column c becomes 7 - c: the bits of every row reversed
+uint64_t Mirror_columns(uint64_t m) {
+	m = ((m >> 1) & 0x5555555555555555ULL) | ((m & 0x5555555555555555ULL) << 1);
+	m = ((m >> 2) & 0x3333333333333333ULL) | ((m & 0x3333333333333333ULL) << 2);
+	return ((m >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((m & 0x0f0f0f0f0f0f0f0fULL) << 4);
+}
+
+//row r becomes 7 - r: the bytes reversed
+uint64_t Mirror_rows(uint64_t m) {
+#ifdef _MSC_VER
+	return _byteswap_uint64(m);
+#else
+	return __builtin_bswap64(m);
+#endif
+}
+
+//square (r, c) goes to (c, r), by swapping the blocks on either side of the
+//diagonal in three steps: 4x4, then 2x2, then single squares
+uint64_t Transpose(uint64_t m) {
+	uint64_t t = 0x0f0f0f0f00000000ULL & (m ^ (m << 28));
+	m ^= t ^ (t >> 28);
+	t = 0x3333000033330000ULL & (m ^ (m << 14));
+	m ^= t ^ (t >> 14);
+	t = 0x5500550055005500ULL & (m ^ (m << 7));
+	return m ^ t ^ (t >> 7);
+}
+
+uint64_t Transform_mask(uint64_t m, int t) {
+	if (t & 1)
+		m = Mirror_columns(m);
+	if (t & 2)
+		m = Mirror_rows(m);
+	if (t & 4)
+		m = Transpose(m);
+	return m;
+}
+
+//the transform that undoes t. a swap of rows and columns turns a mirror of the
+//columns before it into one of the rows after it, and the other way around
+int Inverse_transform(int t) {
+	return (t & 4) ? 4 | ((t & 1) << 1) | ((t & 2) >> 1) : t;
+}
+
+//the one of the 8 transforms of the position that is smallest by own, then opp, so
+//all 8 give the same canonical form. returns the transform that led to it
+int Canonical_form(uint64_t own, uint64_t opp, uint64_t* canonical_own, uint64_t* canonical_opp) {
+	uint64_t o[8];
+	uint64_t p[8];
+	o[0] = own;
+	p[0] = opp;
+	o[1] = Mirror_columns(own);
+	p[1] = Mirror_columns(opp);
+	o[2] = Mirror_rows(own);
+	p[2] = Mirror_rows(opp);
+	o[3] = Mirror_rows(o[1]);
+	p[3] = Mirror_rows(p[1]);
+	for (int t = 0; t < 4; t++) {
+		o[t + 4] = Transpose(o[t]);
+		p[t + 4] = Transpose(p[t]);
+	}
+	int best = 0;
+	for (int t = 1; t < 8; t++)
+		if (o[t] < o[best] || (o[t] == o[best] && p[t] < p[best]))
+			best = t;
+	*canonical_own = o[best];
+	*canonical_opp = p[best];
+	return best;
+}
+
+// one shape of Pattern_eval: its squares in the top-left orientation, and the
+// transforms (see Transform_square) placing it on the board. every placement lists
+// its squares in transformed order so all of them share one weight table
+struct Pattern_type {
+	int size;
+	int instances;
+	int transforms[8];
+	int squares[PATTERN_MAX_SQUARES];
+};
+
+static constexpr Pattern_type pattern_types[PATTERN_TYPES] = {
+	{ 10, 4, { 0, 2, 4, 6 }, { 0, 1, 2, 3, 4, 5, 6, 7, 9, 14 } }, // an edge and its two X-squares
+	{ 10, 8, { 0, 1, 2, 3, 4, 5, 6, 7 }, { 0, 1, 2, 3, 4, 8, 9, 10, 11, 12 } }, // 2x5 corner block
+	{ 9, 4, { 0, 1, 2, 3 }, { 0, 1, 2, 8, 9, 10, 16, 17, 18 } }, // 3x3 corner block
+	{ 8, 2, { 0, 1 }, { 0, 9, 18, 27, 36, 45, 54, 63 } }, // diagonals from corner to corner
+	{ 7, 4, { 0, 1, 4, 6 }, { 1, 10, 19, 28, 37, 46, 55 } }, // and the shorter ones next to them
+	{ 6, 4, { 0, 1, 4, 6 }, { 2, 11, 20, 29, 38, 47 } },
+	{ 5, 4, { 0, 1, 4, 6 }, { 3, 12, 21, 30, 39 } },
+	{ 4, 4, { 0, 1, 4, 6 }, { 4, 13, 22, 31 } },
+};
+
+// transform t of the 8 symmetries of the board: bit 0 mirrors the columns, bit 1 the
+// rows, bit 2 then swaps rows and columns
+constexpr int Transform_square(int sq, int t) {
+	int r = sq / 8;
+	int c = sq % 8;
+	if (t & 1)
+		c = 7 - c;
+	if (t & 2)
+		r = 7 - r;
+	if (t & 4) {
+		int x = r;
+		r = c;
+		c = x;
+	}
+	return r * 8 + c;
+}
+
+// a pattern instance holding a square
+struct Pattern_link {
+	uint16_t instance = 0;
+	uint16_t power = 0; // 3 to the position of the square in that instance
+};
+
+// where every pattern instance is and which instances every square belongs to, so
+// that a changed square can update the indices holding it without looking at the rest
+struct Pattern_tables {
+	int squares[PATTERN_INSTANCES][PATTERN_MAX_SQUARES];
+	int size[PATTERN_INSTANCES];
+	int offset[PATTERN_INSTANCES]; // start of the instance's table within a stage of weights
+	int link_count[64];
+	Pattern_link links[64][PATTERN_LINKS];
+
+	constexpr Pattern_tables() : squares(), size(), offset(), link_count(), links() {
+		int n = 0;
+		int start = 0;
+		for (int p = 0; p < PATTERN_TYPES; p++) {
+			const Pattern_type& type = pattern_types[p];
+			for (int i = 0; i < type.instances; i++, n++) {
+				size[n] = type.size;
+				offset[n] = start;
+				int power = 1;
+				for (int j = 0; j < type.size; j++, power *= 3) {
+					int sq = Transform_square(type.squares[j], type.transforms[i]);
+					squares[n][j] = sq;
+					links[sq][link_count[sq]].instance = (uint16_t)n;
+					links[sq][link_count[sq]].power = (uint16_t)power;
+					link_count[sq]++;
+				}
+			}
+			start += Power_of_3(type.size);
+		}
+	}
+
+	static constexpr int Power_of_3(int n) {
+		return n == 0 ? 1 : 3 * Power_of_3(n - 1);
+	}
+};
+
+static constexpr Pattern_tables pattern_tables;
+
+static_assert(pattern_tables.offset[PATTERN_INSTANCES - 1] + Pattern_tables::Power_of_3(pattern_tables.size[PATTERN_INSTANCES - 1]) == EVAL_MOBILITY,
+	"EVAL_WEIGHTS does not match pattern_types");
+
+Pattern_eval pattern_eval;
+
+Probcut::Probcut() {
+	memset(pairs, 0, sizeof(pairs));
+	loaded = false;
+}
+
+bool Probcut::Load(const char* path) {
+	ifstream in(path, ios::binary);
+	Probcut_header h;
+	if (!in.read((char*)&h, sizeof(h)) || memcmp(h.magic, "OPMC", 4) != 0 || h.version != 1
+		|| h.stages != MPC_STAGES || h.depths != MPC_MAX_DEPTH + 1)
+		return false;
+	if (!in.read((char*)pairs, sizeof(pairs)))
+		return false;
+	loaded = true;
+	return true;
+}
+
+bool Probcut::Save(const char* path) {
+	ofstream out(path, ios::binary);
+	Probcut_header h = { { 'O', 'P', 'M', 'C' }, 1, MPC_STAGES, MPC_MAX_DEPTH + 1 };
+	out.write((const char*)&h, sizeof(h));
+	out.write((const char*)pairs, sizeof(pairs));
+	return (bool)out;
+}
+
+//past the deepest fitted depth the deepest one of the same parity stands in, with the
+//shallow search the same number of plies less deep
+const Probcut_pair* Probcut::Get(int empties, int depth, int* shallow) {
+	int stage = min(max((60 - empties) / MPC_STAGE_MOVES, 0), MPC_STAGES - 1);
+	int d = min(depth, MPC_MAX_DEPTH - (depth - MPC_MAX_DEPTH) % 2);
+	while (d >= MPC_MIN_DEPTH && pairs[stage][d].sigma <= 0)
+		d -= 2;
+	if (d < MPC_MIN_DEPTH)
+		return 0;
+	*shallow = depth - (d - Probcut_shallow(d));
+	return &pairs[stage][d];
+}
+
+Probcut probcut;
+
+//adds digits to the digit of sq in every pattern instance holding it
+inline void Update_patterns(uint16_t* pattern, int sq, int digits) {
+	const Pattern_link* link = pattern_tables.links[sq];
+	for (int k = pattern_tables.link_count[sq]; k > 0; k--, link++)
+		pattern[link->instance] += digits * link->power;
+}
+
+//every index from scratch, black's discs as digit 1 and white's as 2. with own and opp
+//instead the indices are the side to move's, as the weights file has them
+void Get_patterns(uint64_t black, uint64_t white, uint16_t* pattern) {
+	memset(pattern, 0, PATTERN_INSTANCES * sizeof(uint16_t));
+	for (; black; black &= black - 1)
+		Update_patterns(pattern, First_square(black), 1);
+	for (; white; white &= white - 1)
+		Update_patterns(pattern, First_square(white), 2);
+}
+
+//stage of the weights for a position with this many empty squares
+int Eval_stage(int empties) {
+	return min(max((60 - empties) / 4, 0), EVAL_STAGES - 1);
+}
+
+//reads a weights file, keeping the weights already loaded if it is not a whole one
+bool Pattern_eval::Load(const char* path) {
+	ifstream in(path, ios::binary);
+	Weights_header h;
+	if (!in.read((char*)&h, sizeof(h)) || memcmp(h.magic, "OPWT", 4) != 0 || h.version != 1
+		|| h.stages != EVAL_STAGES || h.weights != EVAL_WEIGHTS)
+		return false;
+	vector<int16_t> w(2 * EVAL_STAGES * EVAL_WEIGHTS);
+	if (!in.read((char*)&w[0], EVAL_STAGES * EVAL_WEIGHTS * sizeof(int16_t)))
+		return false;
+
+	// white to move: white's discs are digit 1 in the file's tables, 2 in the indices
+	for (int stage = 0; stage < EVAL_STAGES; stage++) {
+		const int16_t* from = &w[stage * EVAL_WEIGHTS];
+		int16_t* to = &w[(EVAL_STAGES + stage) * EVAL_WEIGHTS];
+		for (int p = 0, n = 0; p < PATTERN_TYPES; n += pattern_types[p++].instances) {
+			int size = pattern_tables.size[n];
+			int offset = pattern_tables.offset[n];
+			for (int idx = 0; idx < Pattern_tables::Power_of_3(size); idx++) {
+				int swapped = 0;
+				for (int j = 0, x = idx, power = 1; j < size; j++, x /= 3, power *= 3)
+					swapped += (x % 3 == 0 ? 0 : 3 - x % 3) * power;
+				to[offset + swapped] = from[offset + idx];
+			}
+		}
+		to[EVAL_MOBILITY] = from[EVAL_MOBILITY];
+		to[EVAL_BIAS] = from[EVAL_BIAS];
+	}
+	weights.swap(w);
+	return true;
+}
+
+bool Pattern_eval::Loaded() {
+	return !weights.empty();
+}
+
+int Pattern_eval::Score(Bit_Board* b) {
+	int stage = Eval_stage(b->empties);
+	const int16_t* w = &weights[((b->side == 1 ? 0 : EVAL_STAGES) + stage) * EVAL_WEIGHTS];
+	int score = w[EVAL_BIAS];
+	for (int i = 0; i < PATTERN_INSTANCES; i++)
+		score += w[pattern_tables.offset[i] + b->pattern[i]];
+	score += w[EVAL_MOBILITY] * (Pop_count(Get_moves(b->own, b->opp)) - Pop_count(Get_moves(b->opp, b->own)));
+	return min(max(score, -WIN_SCORE + 1), WIN_SCORE - 1);
+}
+
+uint64_t zobrist[2][64]; // [0] black discs, [1] white discs
+uint64_t zobrist_flip[64]; // zobrist[0][sq] ^ zobrist[1][sq]
+uint64_t zobrist_white; // xored in when white is to move
+
+// fills the keys before any global board is constructed
+struct Zobrist_init {
+	Zobrist_init() {
+		std::mt19937_64 gen(20190612); // fixed seed so hashes are the same every run
+		for (int c = 0; c < 2; c++)
+			for (int sq = 0; sq < 64; sq++)
+				zobrist[c][sq] = gen();
+		for (int sq = 0; sq < 64; sq++)
+			zobrist_flip[sq] = zobrist[0][sq] ^ zobrist[1][sq];
+		zobrist_white = gen();
+	}
+} zobrist_init;
+
+Bit_Board::Bit_Board() {
+	opp = (1ULL << 27) | (1ULL << 36); // (4, 4) and (5, 5)
+	own = (1ULL << 28) | (1ULL << 35); // (4, 5) and (5, 4)
+	side = 1;
+	own_count = 2;
+	opp_count = 2;
+	empties = 60;
+	moves_made = 0;
+	hash = Compute_hash();
+	Compute_patterns();
+}
+
+uint64_t Bit_Board::Compute_hash() {
+	uint64_t black = Discs(1);
+	uint64_t white = Discs(-1);
+	uint64_t h = side == -1 ? zobrist_white : 0;
+	for (; black; black &= black - 1)
+		h ^= zobrist[0][First_square(black)];
+	for (; white; white &= white - 1)
+		h ^= zobrist[1][First_square(white)];
+	return h;
+}
+
+void Bit_Board::Compute_patterns() {
+	Get_patterns(Discs(1), Discs(-1), pattern);
+}
+
+void Bit_Board::Set_squares(Board* b, int val) {
+	own = 0;
+	opp = 0;
+	side = val;
+	for (int i = 0; i < 8; i++) {
+		for (int j = 0; j < 8; j++) {
+			if (b->Get_square(i + 1, j + 1) == val)
+				own |= 1ULL << (i * 8 + j);
+			else if (b->Get_square(i + 1, j + 1) == -1 * val)
+				opp |= 1ULL << (i * 8 + j);
+		}
+	}
+	own_count = Pop_count(own);
+	opp_count = Pop_count(opp);
+	empties = 64 - own_count - opp_count;
+	moves_made = 0;
+	hash = Compute_hash();
+	Compute_patterns();
+}
+
+void Bit_Board::Set_squares(Bit_Board* b) {
+	own = b->own;
+	opp = b->opp;
+	side = b->side;
+	own_count = b->own_count;
+	opp_count = b->opp_count;
+	empties = b->empties;
+	hash = b->hash;
+	memcpy(pattern, b->pattern, sizeof(pattern));
+	moves_made = 0;
+}
+
+void Bit_Board::Set_discs(uint64_t own_discs, uint64_t opp_discs, int val) {
+	own = own_discs;
+	opp = opp_discs;
+	side = val;
+	own_count = Pop_count(own);
+	opp_count = Pop_count(opp);
+	empties = 64 - own_count - opp_count;
+	moves_made = 0;
+	hash = Compute_hash();
+	Compute_patterns();
+}
+
+void Bit_Board::Swap() {
+	uint64_t t = own;
+	own = opp;
+	opp = t;
+	int c = own_count;
+	own_count = opp_count;
+	opp_count = c;
+	side = -1 * side;
+	hash ^= zobrist_white;
+}
+
+// only the placed disc and the flips are recorded, Unmake_move xors them back out.
+// a flip turns digit 2 (white) into 1 (black) or back, so it moves an index by one
+// power; the indices are few enough that Unmake_move copies them back instead
+void Bit_Board::Make_move(int sq) {
+	Undo_record* u = &history[moves_made++];
+	u->sq = sq;
+	u->flips = 0;
+	u->hash = hash;
+	memcpy(u->pattern, pattern, sizeof(pattern));
+	if (sq != PASS) {
+		u->flips = Get_flips(own, opp, sq);
+		int n = Pop_count(u->flips);
+		own ^= u->flips | (1ULL << sq);
+		opp ^= u->flips;
+		own_count += n + 1;
+		opp_count -= n;
+		empties--;
+		hash ^= zobrist[side == 1 ? 0 : 1][sq];
+		Update_patterns(pattern, sq, side == 1 ? 1 : 2);
+		for (uint64_t f = u->flips; f; f &= f - 1) {
+			int flipped = First_square(f);
+			hash ^= zobrist_flip[flipped];
+			Update_patterns(pattern, flipped, -1 * side);
+		}
+	}
+	Swap();
+}
+
+void Bit_Board::Unmake_move() {
+	Undo_record* u = &history[--moves_made];
+	Swap();
+	hash = u->hash;
+	if (u->sq != PASS) {
+		int n = Pop_count(u->flips);
+		own ^= u->flips | (1ULL << u->sq);
+		opp ^= u->flips;
+		own_count -= n + 1;
+		opp_count += n;
+		empties++;
+		memcpy(pattern, u->pattern, sizeof(pattern));
+	}
+}
+
+uint64_t Bit_Board::Discs(int val) {
+	return val == side ? own : opp;
+}
+
+uint64_t Bit_Board::Moves(int val) {
+	return Get_moves(Discs(val), Discs(-1 * val));
+}
+
+bool Bit_Board::Has_valid_move(int val) {
+	return Moves(val) != 0;
+}
+
+void Bit_Board::Legal_moves(Move_list* moves) {
+	moves->mask = Get_moves(own, opp);
+	moves->count = 0;
+	for (uint64_t m = moves->mask; m; m &= m - 1)
+		moves->list[moves->count++] = First_square(m);
+	if (moves->count == 0 && Get_moves(opp, own) != 0)
+		moves->list[moves->count++] = PASS;
+}
+
+bool Bit_Board::Move_is_valid(int row, int col, int val) {
+	int r = row - 1;
+	int c = col - 1;
+	if (r < 0 || r > 7 || c < 0 || c > 7)
+		return false;
+	int sq = r * 8 + c;
+	if ((own | opp) & (1ULL << sq))
+		return false;
+	return Get_flips(Discs(val), Discs(-1 * val), sq) != 0;
+}
+
+//executes move if it is valid, afterwards the other side is to move
+bool Bit_Board::Play_square(int row, int col, int val) {
+	int sq = (row - 1) * 8 + (col - 1);
+	if (row < 1 || row > 8 || col < 1 || col > 8 || ((own | opp) & (1ULL << sq)))
+		return false;
+	if (Get_flips(Discs(val), Discs(-1 * val), sq) == 0)
+		return false;
+	if (val != side)
+		Swap();
+	Make_move(sq);
+	return true;
+}
+
+int Bit_Board::Get_square(int row, int col) {
+	uint64_t m = 1ULL << ((row - 1) * 8 + (col - 1));
+	if (own & m)
+		return side;
+	if (opp & m)
+		return -1 * side;
+	return 0;
+}
+
+bool Bit_Board::Full_board() {
+	return empties == 0;
+}
+
+//returns score, positive for X player's advantage
+int Bit_Board::Score() {
+	return side * (own_count - opp_count);
+}
+
+int Bit_Board::Free_neighbors(int i, int j) {
+	return Pop_count(Get_neighbors(1ULL << ((i - 1) * 8 + (j - 1))) & ~(own | opp));
+}
+
+// the pattern tables once a weights file is loaded. until then the same terms and
+// weights as Board::Eval, see Mask_eval
+int Bit_Board::Eval(int cpuval, int depth) {
+	return Eval(cpuval, depth, &pattern_eval);
+}
+
+int Bit_Board::Eval(int cpuval, int, Pattern_eval* weights) {
+	if (weights->Loaded())
+		return cpuval == side ? weights->Score(this) : -weights->Score(this);
+	return cpuval == side ? Mask_eval(own, opp) : Mask_eval(opp, own);
+}
+
+Trans_table::Trans_table() {
+	policy = TT_TWO_TIER;
+	bucket_mask = 0;
+	age = 0;
+}
+
+//the table gets the largest power of two buckets that fits in mb megabytes
+void Trans_table::Resize(int mb) {
+	size_t n = 2;
+	while (n * 2 * sizeof(Tt_slot) <= (size_t)mb * 1024 * 1024)
+		n *= 2;
+	entries = vector<Tt_slot>(n);
+	bucket_mask = n / 2 - 1;
+	Clear();
+}
+
+void Trans_table::Clear() {
+	for (size_t i = 0; i < entries.size(); i++) {
+		entries[i].check.store(0, memory_order_relaxed);
+		entries[i].data.store(0, memory_order_relaxed);
+	}
+}
+
+void Trans_table::New_search() {
+	age++;
+}
+
+//the entry in slot, with a key that only matches the one stored if the slot is whole
+Tt_entry Trans_table::Load(Tt_slot* slot) {
+	uint64_t data = slot->data.load(memory_order_relaxed);
+	Tt_entry e;
+	e.key = slot->check.load(memory_order_relaxed) ^ data;
+	e.score = (int16_t)(data & 0xffff);
+	e.depth = (int8_t)((data >> 16) & 0xff);
+	e.move = (int8_t)((data >> 24) & 0xff);
+	e.bound = (uint8_t)((data >> 32) & 0xff);
+	e.age = (uint8_t)((data >> 40) & 0xff);
+	return e;
+}
+
+void Trans_table::Save(Tt_slot* slot, const Tt_entry& e) {
+	uint64_t data = (uint64_t)(uint16_t)e.score
+		| (uint64_t)(uint8_t)e.depth << 16
+		| (uint64_t)(uint8_t)e.move << 24
+		| (uint64_t)e.bound << 32
+		| (uint64_t)e.age << 40;
+	slot->check.store(e.key ^ data, memory_order_relaxed);
+	slot->data.store(data, memory_order_relaxed);
+}
+
+bool Trans_table::Probe(uint64_t key, Tt_entry* e, Tt_counters* c) {
+	if (entries.empty())
+		return false;
+	c->probes++;
+	Tt_slot* bucket = &entries[(key & bucket_mask) * 2];
+	for (int i = 0; i < 2; i++) {
+		*e = Load(&bucket[i]);
+		if (e->key == key) {
+			c->hits++;
+			return true;
+		}
+	}
+	return false;
+}
+
+void Trans_table::Store(uint64_t key, int depth, int score, int bound, int move, Tt_counters* c) {
+	if (entries.empty())
+		return;
+	Tt_slot* bucket = &entries[(key & bucket_mask) * 2];
+	Tt_entry old[2] = { Load(&bucket[0]), Load(&bucket[1]) };
+	Tt_slot* slot;
+	Tt_entry* replaced;
+	if (old[0].key == key || old[1].key == key) {
+		int i = old[0].key == key ? 0 : 1;
+		slot = &bucket[i];
+		replaced = &old[i];
+		// a shallower result of this search does not overwrite a deeper one
+		if (policy != TT_ALWAYS && replaced->age == age && replaced->depth > depth)
+			return;
+	}
+	else if (policy == TT_ALWAYS) {
+		// newest in slot 0, the one before it in slot 1
+		Save(&bucket[1], old[0]);
+		slot = &bucket[0];
+		replaced = &old[1];
+	}
+	else if (policy == TT_DEPTH) {
+		// throw out the shallower entry, entries of older searches count as shallowest
+		int d0 = old[0].age == age ? old[0].depth : -1;
+		int d1 = old[1].age == age ? old[1].depth : -1;
+		slot = d0 <= d1 ? &bucket[0] : &bucket[1];
+		replaced = d0 <= d1 ? &old[0] : &old[1];
+	}
+	else {
+		// slot 0 keeps the deepest entry, slot 1 always takes the rest
+		if (old[0].age != age || depth >= old[0].depth) {
+			Save(&bucket[1], old[0]);
+			slot = &bucket[0];
+			replaced = &old[1];
+		}
+		else {
+			slot = &bucket[1];
+			replaced = &old[1];
+		}
+	}
+	if (replaced->key != 0 && replaced->key != key)
+		c->collisions++;
+	c->stores++;
+	Tt_entry e;
+	e.key = key;
+	e.score = (int16_t)score;
+	e.depth = (int8_t)depth;
+	e.move = (int8_t)move;
+	e.bound = (uint8_t)bound;
+	e.age = age;
+	Save(slot, e);
+}
+
+bool Make_simple_cpu_move(Board* b, int cpuval) {
+	for (int i = 1; i < 9; i++)
+		for (int j = 1; j < 9; j++)
+			if (b->Get_square(i, j) == 0)
+				if (b->Play_square(i, j, cpuval))
+					return true;
+	cout << "Computer passes." << endl;
+	return false;
+}
+
+bool Make_smarter_cpu_move(Board* b, int cpuval) {
+	pair<int, int> temp;
+	Stop_ponder(); // a book move must not leave it writing to trans_table
+	if (!Book_move(b, cpuval, &temp))
+		temp = Ponder_decision(b, cpuval);
+	if (b->Get_square(temp.first, temp.second) == 0) {
+		if (b->Play_square(temp.first, temp.second, cpuval))
+			return true;
+	}
+	cout << "Computer passes." << endl;
+	return false;
+}
+
+Search_stack search_stack; // main thread's, shared by every call of Minimax_decision
+vector<Search_stack> helper_stacks; // one for each extra thread
+Trans_table trans_table; // keeps its entries from one move to the next
+Search_options search_options = { 18, 20, 1, 12, MAX_PLY, 20, 0, 0, false, DEFAULT_PROBCUT_T };
+Time_manager time_manager;
+atomic<bool> search_stop; // the main thread is done, helpers drop what they are searching
+vector<Work_queue> work_queues; // [id] for each searching thread
+atomic<bool> search_split; // the main thread is solving, helpers take its solver tasks instead of searching on their own
+Opening_book opening_book;
+bool search_stats; // Minimax_decision reports every search on cerr
+ofstream search_log; // and as json lines here, when open
+Search_stack ponder_stack; // of the search on the human's time
+Bit_Board ponder_board; // position it searches
+Time_manager ponder_clock;
+thread ponder_thread; // joinable while it runs
+bool ponder_unused = false; // ponder_stack holds a search no Ponder_decision has looked at
+
+//whether s must give up: the move is over, or its time or node budget is used up. a
+//helper also drops its own search once the main thread starts solving
+inline bool Out_of_budget(Search_stack* s) {
+	return search_stop || s->clock->Out_of_time() || (s->node_limit > 0 && s->nodes >= s->node_limit)
+		|| (s->id > 0 && s->sp == 0 && search_split);
+}
+
+Time_manager::Time_manager() {
+	soft_limit = 0;
+	hard_limit = 0;
+	game_left = 0;
+	credit = 0;
+}
+
+void Time_manager::New_game() {
+	game_left = search_options.game_seconds;
+}
+
+//without a game budget the move gets search_options.move_seconds. with one it gets a
+//share of what is left for the moves still to come, and may run over that share a few
+//times if an iteration needs it, but never past half of the rest of the game
+void Time_manager::Start_move(int empties) {
+	start = chrono::steady_clock::now();
+	soft_limit = search_options.move_seconds;
+	hard_limit = search_options.move_seconds;
+	if (search_options.game_seconds > 0) {
+		int moves_left = max((empties + 1) / 2, 1); // the computer plays every other move
+		double share = max(game_left, 0.0) / moves_left;
+		soft_limit = min(soft_limit, share);
+		hard_limit = min(hard_limit, min(share * 4, max(game_left, 0.0) / 2));
+	}
+	soft_limit -= credit;
+	hard_limit -= credit;
+	credit = 0;
+}
+
+void Time_manager::Start_fixed(double seconds) {
+	start = chrono::steady_clock::now();
+	soft_limit = seconds;
+	hard_limit = seconds;
+}
+
+void Time_manager::End_move() {
+	game_left -= Elapsed();
+}
+
+double Time_manager::Elapsed() {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//last is how long the last iteration took, two_back the one two depths before it.
+//the next iteration is predicted from their ratio, which skips over the odd / even
+//swing between neighbouring depths; one that would run past hard_limit gets cut off
+//and thrown away anyway
+bool Time_manager::Start_iteration(double last, double two_back) {
+	double elapsed = Elapsed();
+	if (elapsed >= soft_limit)
+		return false;
+	double ebf = DEFAULT_EBF;
+	if (two_back > 0.001)
+		ebf = min(max(sqrt(last / two_back), 1.0), 16.0);
+	return elapsed + last * ebf < hard_limit;
+}
+
+pair<int, int> Minimax_decision(Board* b, int cpuval) {
+	// returns a pair<int, int> <i, j> for row, column of best move
+	Search_stack* s = &search_stack;
+	Bit_Board* bt = &s->board;
+	bt->Set_squares(b, cpuval);
+	if (!trans_table.Allocated())
+		trans_table.Resize(TT_DEFAULT_MB);
+	trans_table.New_search();
+
+	pair<int, int> ret;
+	Move_list moves;
+	bt->Legal_moves(&moves);
+	Exclude_moves(&moves, s->root_exclude);
+	if (moves.mask == 0) {
+		time_manager.Credit(0); // a ponder credit belongs to this move, not a later one
+		ret.first = 1; // just return something so comp can pass
+		ret.second = 1;
+		return ret;
+	}
+	if (moves.count == 1) { // nothing to think about
+		time_manager.Credit(0);
+		ret.first = moves.list[0] / 8 + 1;
+		ret.second = moves.list[0] % 8 + 1;
+		return ret;
+	}
+
+	// start clock
+	time_manager.Start_move(bt->empties);
+	s->clock = &time_manager;
+	Prepare_search(s);
+
+	// lazy smp: the helpers search the same root at staggered depths and only talk to
+	// the main thread through trans_table, whose entries let it skip work they did
+	int helpers = max(search_options.threads, 1) - 1;
+	if ((int)helper_stacks.size() < helpers)
+		helper_stacks.resize(helpers);
+	if ((int)work_queues.size() < helpers + 1)
+		work_queues = vector<Work_queue>(helpers + 1);
+	search_stop = false;
+	search_split = false;
+	s->id = 0;
+	s->helpers = helpers;
+	vector<thread> workers;
+	for (int i = 0; i < helpers; i++) {
+		Search_stack* h = &helper_stacks[i];
+		h->board.Set_squares(bt);
+		h->id = i + 1;
+		h->clock = &time_manager;
+		h->root_exclude = s->root_exclude;
+		Prepare_search(h);
+		workers.push_back(thread(Iterative_deepening, h, i + 1));
+	}
+	Iterative_deepening(s, 0);
+	search_stop = true;
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	time_manager.End_move();
+
+	// a helper that finished a deeper iteration than the main thread knows better,
+	// unless the main thread solved the position
+	int best = s->best_move;
+	int best_depth = s->completed_depth;
+	for (int i = 0; i < helpers && !s->solved; i++) {
+		if (helper_stacks[i].completed_depth > best_depth) {
+			best = helper_stacks[i].best_move;
+			best_depth = helper_stacks[i].completed_depth;
+		}
+	}
+
+	if (best == NO_MOVE) // not even depth 1 finished in time
+		best = moves.list[0];
+	ret.first = best / 8 + 1;
+	ret.second = best % 8 + 1;
+
+	if (search_stats || search_log.is_open())
+		Report_search(s, helpers, best, best_depth);
+
+	return ret;
+}
+
+//starts searching on the human's time: the position after the reply the last search
+//expects, when b is the position its best line led to, or else b itself with human to
+//move, which fills trans_table for every reply. a ponder still running is stopped first
+void Start_ponder(Board* b, int human) {
+	if (!search_options.ponder)
+		return;
+	Stop_ponder();
+	Bit_Board now;
+	now.Set_squares(b, human);
+	Search_stack* last = &search_stack;
+	Bit_Board expected;
+	expected.Set_squares(&last->board);
+	ponder_board.Set_squares(&now);
+	if (last->prev_pv_length >= 2 && last->prev_pv[0] != PASS && (expected.Moves(expected.side) & (1ULL << last->prev_pv[0]))) {
+		expected.Make_move(last->prev_pv[0]);
+		int reply = last->prev_pv[1];
+		if (expected.own == now.own && expected.opp == now.opp && expected.side == now.side
+			&& reply != PASS && (now.Moves(now.side) & (1ULL << reply)))
+			ponder_board.Make_move(reply);
+	}
+
+	if (!trans_table.Allocated())
+		trans_table.Resize(TT_DEFAULT_MB);
+	Search_stack* s = &ponder_stack;
+	s->board.Set_squares(&ponder_board);
+	s->clock = &ponder_clock;
+	s->id = 0;
+	Prepare_search(s);
+	ponder_clock.Start_fixed(1e9); // until the human moves
+	search_stop = false;
+	search_split = false;
+	ponder_thread = thread(Iterative_deepening, s, 0);
+	ponder_unused = true;
+}
+
+//stops the ponder search, if there is one. its result stays in ponder_stack
+void Stop_ponder() {
+	if (!ponder_thread.joinable())
+		return;
+	search_stop = true;
+	ponder_thread.join();
+	search_stop = false;
+}
+
+//the move for cpuval on b once the human has moved, stopping the ponder search if
+//it still runs. when it searched this very position its time counts as spent on the
+//move, and its move is played if it got deeper than the search that is left
+pair<int, int> Ponder_decision(Board* b, int cpuval) {
+	bool pondering = ponder_unused;
+	ponder_unused = false;
+	Stop_ponder();
+	Bit_Board now;
+	now.Set_squares(b, cpuval);
+	bool hit = pondering && now.own == ponder_board.own && now.opp == ponder_board.opp && now.side == ponder_board.side;
+	if (hit)
+		time_manager.Credit(ponder_clock.Elapsed());
+	pair<int, int> move = Minimax_decision(b, cpuval);
+	Search_stack* p = &ponder_stack;
+	if (hit && p->best_move != NO_MOVE && p->best_move != PASS && p->completed_depth > search_stack.completed_depth
+		&& (now.Moves(cpuval) & (1ULL << p->best_move))) {
+		move.first = p->best_move / 8 + 1;
+		move.second = p->best_move % 8 + 1;
+	}
+	return move;
+}
+
+//readies s for a search of s->board, keeping what it learned about move order
+void Prepare_search(Search_stack* s) {
+	s->timed_out = false;
+	s->solving = false;
+	s->solved = false;
+	s->helpers = 0;
+	s->sp = 0;
+	s->cancelled = false;
+	for (int d = 0; d <= MAX_PLY; d++) {
+		s->killers[d][0] = NO_MOVE;
+		s->killers[d][1] = NO_MOVE;
+		s->iteration_seconds[d] = -1;
+	}
+	for (int c = 0; c < 2; c++)
+		for (int sq = 0; sq < 64; sq++)
+			s->history[c][sq] /= 2; // older moves count less
+	s->depth_limit = search_options.max_depth;
+	s->node_limit = search_options.max_nodes;
+	s->table = &trans_table;
+	s->eval = &pattern_eval;
+	s->probcut_t = search_options.probcut_t;
+	s->prev_pv_length = 0;
+	s->cutoffs = 0;
+	s->first_move_cutoffs = 0;
+	s->nodes = 0;
+	s->eval_calls = 0;
+	s->tt.probes = 0;
+	s->tt.hits = 0;
+	s->tt.stores = 0;
+	s->tt.collisions = 0;
+	s->completed_depth = 0;
+	s->best_move = NO_MOVE;
+	s->score = 0;
+}
+
+//row,column of a move as the analysis output writes it
+string Move_text(int sq) {
+	if (sq == PASS)
+		return "pass";
+	if (sq < 0 || sq >= 64)
+		return "none";
+	return to_string(sq / 8 + 1) + "," + to_string(sq % 8 + 1);
+}
+
+//what the search of one move did: a line for every iteration the main thread finished,
+//then the whole move summed over every thread. the counters are the stacks' own, so
+//nothing is shared while searching and this only reads them after the threads joined
+void Report_search(Search_stack* s, int helpers, int best, int best_depth) {
+	int empties = s->board.empties;
+	Iteration_stats last = {};
+	double last_seconds = 0;
+	long long last_nodes = 0; // of the iteration before, for the branching factor
+	for (int depth = 1; depth <= s->completed_depth; depth++) {
+		if (s->iteration_seconds[depth] < 0)
+			continue;
+		Iteration_stats* it = &s->iterations[depth];
+		long long nodes = it->nodes - last.nodes;
+		long long cutoffs = it->cutoffs - last.cutoffs;
+		long long evals = it->eval_calls - last.eval_calls;
+		double seconds = s->iteration_seconds[depth] - last_seconds;
+		double first = cutoffs > 0 ? 100.0 * (it->first_move_cutoffs - last.first_move_cutoffs) / cutoffs : 0;
+		double ebf = last_nodes > 0 ? (double)nodes / last_nodes : 0;
+		long long nps = (long long)(nodes / max(seconds, 1e-6));
+		string pv;
+		for (int d = 0; d < it->pv_length; d++)
+			pv += (d > 0 ? " " : "") + Move_text(it->pv[d]);
+		string move = Move_text(it->pv_length > 0 ? it->pv[0] : NO_MOVE);
+
+		if (search_stats) {
+			char line[200];
+			snprintf(line, sizeof(line), "depth %d nodes %lld nps %lld cutoffs %lld first %.1f%% ebf %.2f evals %lld time %.3fs",
+				depth, nodes, nps, cutoffs, first, ebf, evals, seconds);
+			cerr << line << " move " << move << " score " << it->score << " pv " << pv << endl;
+		}
+		if (search_log.is_open()) {
+			string pv_json;
+			for (int d = 0; d < it->pv_length; d++)
+				pv_json += (d > 0 ? ",\"" : "\"") + Move_text(it->pv[d]) + "\"";
+			search_log << "{\"type\":\"iteration\",\"empties\":" << empties << ",\"depth\":" << depth
+				<< ",\"nodes\":" << nodes << ",\"nps\":" << nps << ",\"cutoffs\":" << cutoffs
+				<< ",\"first_move_cutoff_rate\":" << first / 100 << ",\"ebf\":" << ebf << ",\"eval_calls\":" << evals
+				<< ",\"seconds\":" << seconds << ",\"best_move\":\"" << move << "\",\"score\":" << it->score
+				<< ",\"pv\":[" << pv_json << "]}" << endl;
+		}
+		last = *it;
+		last_seconds = s->iteration_seconds[depth];
+		last_nodes = nodes;
+	}
+
+	// the whole move, the unfinished last iteration and the helpers included
+	long long nodes = s->nodes;
+	long long cutoffs = s->cutoffs;
+	long long first_cutoffs = s->first_move_cutoffs;
+	long long evals = s->eval_calls;
+	for (int i = 0; i < helpers; i++) {
+		nodes += helper_stacks[i].nodes;
+		cutoffs += helper_stacks[i].cutoffs;
+		first_cutoffs += helper_stacks[i].first_move_cutoffs;
+		evals += helper_stacks[i].eval_calls;
+	}
+	double seconds = s->clock->Elapsed();
+	double first = cutoffs > 0 ? 100.0 * first_cutoffs / cutoffs : 0;
+	long long nps = (long long)(nodes / max(seconds, 1e-6));
+	if (search_stats) {
+		char line[200];
+		snprintf(line, sizeof(line), "move %s depth %d nodes %lld nps %lld cutoffs %lld first %.1f%% evals %lld time %.3fs threads %d",
+			Move_text(best).c_str(), best_depth, nodes, nps, cutoffs, first, evals, seconds, helpers + 1);
+		cerr << line << endl;
+	}
+	if (search_log.is_open())
+		search_log << "{\"type\":\"move\",\"empties\":" << empties << ",\"best_move\":\"" << Move_text(best)
+			<< "\",\"depth\":" << best_depth << ",\"nodes\":" << nodes << ",\"nps\":" << nps << ",\"cutoffs\":" << cutoffs
+			<< ",\"first_move_cutoff_rate\":" << first / 100 << ",\"eval_calls\":" << evals << ",\"seconds\":" << seconds
+			<< ",\"threads\":" << helpers + 1 << "}" << endl;
+}
+
+// helper i skips the depths where (depth + skip_phase[i]) / skip_size[i] is odd, so
+// the helpers spread over the next few depths instead of all doing the main thread's
+static const int skip_size[20] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+static const int skip_phase[20] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+//iterative deepening of one thread, id 0 for the main one. the result of every
+//finished iteration is left in s
+void Iterative_deepening(Search_stack* s, int id) {
+	Bit_Board* bt = &s->board;
+	double took[MAX_PLY + 1]; // how long each iteration of the main thread took
+
+	for (int depth = 1; depth <= s->depth_limit; depth++) { // iterative deepening
+		if (id > 0) {
+			int i = (id - 1) % 20;
+			if (search_stop || search_split)
+				break;
+			if ((depth + skip_phase[i]) / skip_size[i] % 2 == 1 && depth < s->depth_limit)
+				continue;
+		}
+		s->maxdepth = depth;
+
+		// aspiration window around the last score, widened on the side it fails. not
+		// when the solver answers for every move, a heuristic score says nothing there.
+		// once every root move is in reach of the solver and SOLVE_MIN_DEPTH heuristic
+		// iterations are done, or the depth limit comes first, the main thread hands
+		// the root to it if Solve_estimate fits the time left. should the solve run out
+		// of time anyway, the deepest heuristic iteration still stands
+		bool solving = id == 0 && depth > 1 && (depth > SOLVE_MIN_DEPTH || depth == s->depth_limit)
+			&& bt->empties - 1 <= search_options.wld_empties
+			&& Solve_estimate(bt->empties) * SOLVE_MARGIN <= s->clock->Remaining();
+		s->solving = solving;
+		if (solving && s->helpers > 0)
+			search_split = true;
+		int delta = ASPIRATION_WINDOW;
+		int alpha = -INF_SCORE;
+		int beta = INF_SCORE;
+		if (s->completed_depth > 0 && abs(s->score) < WIN_SCORE && !solving) {
+			alpha = s->score - delta;
+			beta = s->score + delta;
+		}
+		int score = 0;
+		while (true) {
+			s->follow_pv = true;
+			int val = Negamax(s, alpha, beta, 0);
+			if (s->timed_out)
+				break;
+			if (val <= alpha && alpha > -INF_SCORE)
+				alpha = max(-INF_SCORE, val - delta);
+			else if (val >= beta && beta < INF_SCORE)
+				beta = min(INF_SCORE, val + delta);
+			else {
+				score = val;
+				break;
+			}
+			delta *= 2;
+		}
+		if (s->timed_out) // the unfinished iteration is not trusted
+			break;
+
+		s->completed_depth = depth;
+		s->best_move = s->frames[0].best;
+		s->score = score;
+		s->iteration_seconds[depth] = s->clock->Elapsed();
+		Iteration_stats* stats = &s->iterations[depth];
+		stats->nodes = s->nodes;
+		stats->cutoffs = s->cutoffs;
+		stats->first_move_cutoffs = s->first_move_cutoffs;
+		stats->eval_calls = s->eval_calls;
+		stats->score = score;
+		stats->pv_length = s->pv_length[0];
+		for (int d = 0; d < s->pv_length[0]; d++)
+			stats->pv[d] = s->pv[0][d];
+		s->prev_pv_length = s->pv_length[0];
+		for (int d = 0; d < s->pv_length[0]; d++)
+			s->prev_pv[d] = s->pv[0][d];
+		if (id == 0 && s->report)
+			s->report(s, depth);
+
+		if (solving) {
+			s->solved = true;
+			break; // every move was solved, deeper iterations give the same answer
+		}
+		if (id == 0) { // the helpers run until search_stop
+			if (abs(score) >= WIN_SCORE)
+				break; // a proven win or loss, deeper iterations only change the margin
+			took[depth] = s->iteration_seconds[depth] - (depth > 1 ? s->iteration_seconds[depth - 1] : 0);
+			if (!s->clock->Start_iteration(took[depth], depth > 2 ? took[depth - 2] : 0))
+				break;
+		}
+
+		// add a little randomness to throw off other computer who thinks we are playing optimally
+		// by cutting off at a ID depth sometimes
+		//if ( (rand() % 100) <= 3)
+		//	break;
+	}
+
+	// the endgame tree is searched in one piece by splitting it, see Solve_split. a
+	// helper that could still be needed waits for the main thread's solver tasks
+	if (id > 0 && bt->empties - 1 <= search_options.wld_empties) {
+		s->timed_out = false;
+		while (!search_stop) {
+			Solve_task t;
+			if (search_split && Steal_task(s, 0, &t))
+				Run_task(s, t);
+			else
+				this_thread::yield();
+		}
+	}
+}
+
+//plays random moves from the start position with a fixed seed, so every run of
+//Smp_report gets the same positions
+void Random_position(Board* b, int moves, mt19937* gen) {
+	int val = 1;
+	for (int n = 0; n < moves; n++) {
+		if (!b->Has_valid_move(val)) {
+			val = -1 * val;
+			if (!b->Has_valid_move(val))
+				return;
+		}
+		vector<int> valid;
+		for (int i = 1; i < 9; i++)
+			for (int j = 1; j < 9; j++)
+				if (b->Get_square(i, j) == 0 && b->Move_is_valid(i, j, val))
+					valid.push_back(i * 10 + j);
+		int m = valid[(*gen)() % valid.size()];
+		b->Play_square(m / 10, m % 10, val);
+		val = -1 * val;
+	}
+}
+
+//time to depth of single threaded search against threads threads, searching each
+//position of a fixed midgame set to depth with an empty table
+void Smp_report(int threads, int depth, int positions) {
+	Search_options saved = search_options;
+	search_options.max_depth = depth;
+	search_options.move_seconds = 1e9; // every run goes all the way to depth
+	search_options.game_seconds = 0;
+	double total[2][MAX_PLY + 1] = {};
+	long long nodes[2] = {};
+	double seconds[2] = {};
+	int thread_count[2] = { 1, threads };
+	mt19937 gen(20240601);
+
+	for (int p = 0; p < positions; p++) {
+		Board b;
+		Random_position(&b, 20 + p % 4, &gen);
+		for (int run = 0; run < 2; run++) {
+			search_options.threads = thread_count[run];
+			trans_table.Clear();
+			memset(search_stack.history, 0, sizeof(search_stack.history));
+			for (size_t i = 0; i < helper_stacks.size(); i++)
+				memset(helper_stacks[i].history, 0, sizeof(helper_stacks[i].history));
+			pair<int, int> move = Minimax_decision(&b, 1);
+
+			// a depth counts as reached when the first thread finished it
+			int helpers = thread_count[run] - 1;
+			for (int d = 1; d <= depth; d++) {
+				double t = search_stack.iteration_seconds[d];
+				for (int i = 0; i < helpers; i++) {
+					double h = helper_stacks[i].iteration_seconds[d];
+					if (h >= 0 && (t < 0 || h < t))
+						t = h;
+				}
+				total[run][d] += t;
+			}
+			long long n = search_stack.nodes;
+			for (int i = 0; i < helpers; i++)
+				n += helper_stacks[i].nodes;
+			nodes[run] += n;
+			seconds[run] += search_stack.iteration_seconds[depth];
+			cout << "position " << p + 1 << " threads " << thread_count[run] << " move " << move.first << "," << move.second
+				<< " depth " << search_stack.completed_depth << " nodes " << n
+				<< " time " << search_stack.iteration_seconds[depth] << "s" << endl;
+		}
+	}
+
+	cout << endl << "depth\t1 thread\t" << threads << " threads\tspeedup" << endl;
+	for (int d = 1; d <= depth; d++) {
+		cout << d << "\t" << total[0][d] << "\t" << total[1][d] << "\t";
+		if (total[0][d] > 0 && total[1][d] > 0)
+			cout << total[0][d] / total[1][d];
+		cout << endl;
+	}
+	for (int run = 0; run < 2; run++)
+		cout << thread_count[run] << " threads: " << nodes[run] << " nodes, "
+			<< (long long)(nodes[run] / max(seconds[run], 1e-6)) << " nodes/s" << endl;
+	search_options = saved;
+}
+
+Mapped_file::Mapped_file() {
+	data = 0;
+	size = 0;
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = 0;
+#else
+	fd = -1;
+#endif
+}
+
+Mapped_file::~Mapped_file() {
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+#else
+	if (data)
+		munmap((void*)data, size);
+	if (fd >= 0)
+		close(fd);
+#endif
+}
+
+//maps path, an empty file maps to no data but still opens
+bool Mapped_file::Open(const char* path) {
+#ifdef _WIN32
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER length;
+	if (!GetFileSizeEx(file, &length))
+		return false;
+	size = (size_t)length.QuadPart;
+	if (size == 0)
+		return true;
+	mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (!mapping)
+		return false;
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	return data != 0;
+#else
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+		return false;
+	size = (size_t)st.st_size;
+	if (size == 0)
+		return true;
+	void* p = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED)
+		return false;
+	madvise(p, size, MADV_SEQUENTIAL);
+	data = (const char*)p;
+	return true;
+#endif
+}
+
+// what the self-play threads share
+struct Self_play_job {
+	int games;
+	int random_moves;
+	atomic<int> next_game;
+	mutex lock; // guards out and the counts
+	ofstream* out;
+	int games_done;
+	long long samples;
+};
+
+//plays games of job until there are none left. each game opens with random_moves
+//random moves, then both sides search to search_options.max_depth
+void Self_play_games(Search_stack* s, Self_play_job* job) {
+	vector<Sample> samples;
+	vector<int> sides;
+	for (int game = job->next_game++; game < job->games; game = job->next_game++) {
+		mt19937 gen(20240901 + game); // a game is the same whichever thread plays it
+		Bit_Board b;
+		samples.clear();
+		sides.clear();
+		for (int ply = 0; ; ply++) {
+			Move_list moves;
+			b.Legal_moves(&moves);
+			if (moves.count == 0)
+				break;
+			if (moves.mask == 0) {
+				b.Make_move(PASS);
+				continue;
+			}
+			int sq;
+			if (ply < job->random_moves)
+				sq = moves.list[gen() % moves.count];
+			else {
+				Sample x = { b.own, b.opp, 0 };
+				samples.push_back(x);
+				sides.push_back(b.side);
+				if (moves.count == 1)
+					sq = moves.list[0];
+				else {
+					s->board.Set_squares(&b);
+					Prepare_search(s);
+					Iterative_deepening(s, 0);
+					sq = s->best_move == NO_MOVE ? moves.list[0] : s->best_move;
+				}
+			}
+			b.Make_move(sq);
+		}
+
+		int black_margin = b.Score();
+		for (size_t i = 0; i < samples.size(); i++)
+			samples[i].score = (int8_t)(sides[i] * black_margin);
+		lock_guard<mutex> hold(job->lock);
+		if (!samples.empty())
+			job->out->write((const char*)&samples[0], samples.size() * sizeof(Sample));
+		job->games_done++;
+		job->samples += samples.size();
+		if (job->games_done % 100 == 0 || job->games_done == job->games)
+			cerr << "\rgames " << job->games_done << " samples " << job->samples << flush;
+	}
+}
+
+//appends the positions of games self-play games to path, search_options.threads games
+//at a time, for Tune to learn from
+void Self_play(const char* path, int games, int depth, int random_moves) {
+	ofstream out(path, ios::binary | ios::app);
+	if (!out) {
+		cerr << "could not open " << path << endl;
+		return;
+	}
+	Search_options saved = search_options;
+	search_options.max_depth = depth;
+	search_options.move_seconds = 1e9; // every move is searched to depth
+	search_options.game_seconds = 0;
+	search_options.exact_empties = min(search_options.exact_empties, SELF_PLAY_SOLVE_EMPTIES);
+	search_options.wld_empties = search_options.exact_empties;
+	if (!trans_table.Allocated())
+		trans_table.Resize(TT_DEFAULT_MB);
+	time_manager.Start_move(60);
+	search_stop = false;
+	search_split = false;
+
+	Self_play_job job;
+	job.games = games;
+	job.random_moves = random_moves;
+	job.next_game = 0;
+	job.out = &out;
+	job.games_done = 0;
+	job.samples = 0;
+	int threads = max(search_options.threads, 1);
+	vector<Search_stack> stacks(threads);
+	vector<thread> workers;
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < threads; i++) {
+		stacks[i].clock = &time_manager;
+		workers.push_back(thread(Self_play_games, &stacks[i], &job));
+	}
+	for (int i = 0; i < threads; i++)
+		workers[i].join();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cerr << endl << job.samples << " samples from " << games << " games in " << seconds << "s" << endl;
+	search_options = saved;
+}
+
+// least squares gradient sums of one tuning thread
+struct Tune_sums {
+	vector<double> error; // [stage][EVAL_WEIGHTS] error times feature value
+	vector<double> norm; // feature value squared, so the count of a pattern entry
+	double squared_error;
+};
+
+//adds the errors of samples [first, last) with weights w to t
+void Tune_range(const Sample* samples, size_t first, size_t last, const float* w, Tune_sums* t) {
+	uint16_t pattern[PATTERN_INSTANCES];
+	for (size_t i = first; i < last; i++) {
+		const Sample& x = samples[i];
+		int stage = Eval_stage(64 - Pop_count(x.own | x.opp));
+		const float* ws = w + stage * EVAL_WEIGHTS;
+		double* error = &t->error[stage * EVAL_WEIGHTS];
+		double* norm = &t->norm[stage * EVAL_WEIGHTS];
+		Get_patterns(x.own, x.opp, pattern);
+		int mobility = Pop_count(Get_moves(x.own, x.opp)) - Pop_count(Get_moves(x.opp, x.own));
+
+		double predicted = ws[EVAL_BIAS] + ws[EVAL_MOBILITY] * mobility;
+		for (int n = 0; n < PATTERN_INSTANCES; n++)
+			predicted += ws[pattern_tables.offset[n] + pattern[n]];
+		double e = x.score * EVAL_DISC - predicted;
+		t->squared_error += e * e;
+
+		for (int n = 0; n < PATTERN_INSTANCES; n++) {
+			error[pattern_tables.offset[n] + pattern[n]] += e;
+			norm[pattern_tables.offset[n] + pattern[n]] += 1;
+		}
+		error[EVAL_MOBILITY] += e * mobility;
+		norm[EVAL_MOBILITY] += mobility * mobility;
+		error[EVAL_BIAS] += e;
+		norm[EVAL_BIAS] += 1;
+	}
+}
+
+//fits the weights of Pattern_eval to the margins of the samples in samples_path by
+//least squares, every weight moving by its share of its average error each epoch,
+//and writes them to weights_path. the samples are read where they are mapped and
+//split between search_options.threads threads
+void Tune(const char* samples_path, const char* weights_path, int epochs) {
+	Mapped_file file;
+	if (!file.Open(samples_path) || file.Size() % sizeof(Sample) != 0) {
+		cerr << "could not read samples from " << samples_path << endl;
+		return;
+	}
+	const Sample* samples = (const Sample*)file.Data();
+	size_t count = file.Size() / sizeof(Sample);
+	if (count == 0) {
+		cerr << samples_path << " has no samples" << endl;
+		return;
+	}
+	int threads = max(search_options.threads, 1);
+	vector<float> w(EVAL_STAGES * EVAL_WEIGHTS, 0.0f);
+	vector<Tune_sums> sums(threads);
+	for (int i = 0; i < threads; i++) {
+		sums[i].error.resize(w.size());
+		sums[i].norm.resize(w.size());
+	}
+	cerr << count << " samples" << endl;
+
+	for (int epoch = 1; epoch <= epochs; epoch++) {
+		auto start = chrono::steady_clock::now();
+		double squared_error = 0;
+		for (size_t first = 0; first < count; first += TUNE_BATCH) {
+			size_t size = min(count - first, (size_t)TUNE_BATCH);
+			vector<thread> workers;
+			for (int i = 0; i < threads; i++) {
+				fill(sums[i].error.begin(), sums[i].error.end(), 0.0);
+				fill(sums[i].norm.begin(), sums[i].norm.end(), 0.0);
+				sums[i].squared_error = 0;
+				workers.push_back(thread(Tune_range, samples, first + size * i / threads, first + size * (i + 1) / threads, &w[0], &sums[i]));
+			}
+			for (int i = 0; i < threads; i++)
+				workers[i].join();
+
+			for (int i = 0; i < threads; i++)
+				squared_error += sums[i].squared_error;
+			for (size_t k = 0; k < w.size(); k++) {
+				double error = 0;
+				double norm = 0;
+				for (int i = 0; i < threads; i++) {
+					error += sums[i].error[k];
+					norm += sums[i].norm[k];
+				}
+				if (norm > 0)
+					w[k] += (float)(TUNE_RATE * error / (norm + TUNE_DAMPING));
+			}
+		}
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		cerr << "epoch " << epoch << " rms error " << sqrt(squared_error / count) / EVAL_DISC << " discs, "
+			<< seconds << "s" << endl;
+	}
+
+	vector<int16_t> out(w.size());
+	for (size_t k = 0; k < w.size(); k++)
+		out[k] = (int16_t)min(max(lround(w[k]), -32767L), 32767L);
+	Weights_header h = { { 'O', 'P', 'W', 'T' }, 1, EVAL_STAGES, EVAL_WEIGHTS };
+	ofstream o(weights_path, ios::binary);
+	o.write((const char*)&h, sizeof(h));
+	o.write((const char*)&out[0], out.size() * sizeof(int16_t));
+	if (!o)
+		cerr << "could not write " << weights_path << endl;
+}
+
+// what the probcut fitting threads share
+struct Probcut_job {
+	vector<Sample> positions;
+	vector<int> scores; // [position][depth], -INF_SCORE where the search did not get there
+	int depth;
+	atomic<int> next;
+	atomic<int> done;
+};
+
+//searches the positions of job until there are none left, every one by iterative
+//deepening to job->depth without probcut, and keeps the score of every iteration
+void Fit_probcut_positions(Search_stack* s, Probcut_job* job) {
+	Time_manager clock;
+	for (int i = job->next++; i < (int)job->positions.size(); i = job->next++) {
+		const Sample& x = job->positions[i];
+		s->board.Set_discs(x.own, x.opp, 1);
+		s->clock = &clock;
+		Prepare_search(s);
+		s->depth_limit = job->depth;
+		s->probcut_t = 0;
+		clock.Start_fixed(1e9);
+		Iterative_deepening(s, 0);
+		for (int d = 1; d <= s->completed_depth; d++)
+			job->scores[i * (MPC_MAX_DEPTH + 1) + d] = s->iterations[d].score;
+		int done = ++job->done;
+		if (done % 50 == 0)
+			cerr << "\rpositions " << done << flush;
+	}
+}
+
+//fits the probcut regressions from positions of the sample file at samples_path,
+//spread evenly over it, searched up to depth, and writes them to out_path. the
+//solver stays out of it so every score comes from the evaluation
+void Fit_probcut(const char* samples_path, int positions, int depth, const char* out_path) {
+	Mapped_file file;
+	if (!file.Open(samples_path) || file.Size() % sizeof(Sample) != 0 || file.Size() == 0) {
+		cerr << "could not read samples from " << samples_path << endl;
+		return;
+	}
+	const Sample* samples = (const Sample*)file.Data();
+	size_t count = file.Size() / sizeof(Sample);
+	Probcut_job job;
+	for (int i = 0; i < positions; i++) {
+		const Sample& x = samples[(size_t)i * count / positions];
+		if (64 - Pop_count(x.own | x.opp) > depth && Get_moves(x.own, x.opp) != 0)
+			job.positions.push_back(x);
+	}
+	job.depth = depth;
+	job.scores.assign(job.positions.size() * (MPC_MAX_DEPTH + 1), -INF_SCORE);
+	job.next = 0;
+	job.done = 0;
+
+	Search_options saved = search_options;
+	search_options.exact_empties = 0;
+	search_options.wld_empties = 0;
+	search_options.game_seconds = 0;
+	if (!trans_table.Allocated())
+		trans_table.Resize(TT_DEFAULT_MB);
+	search_stop = false;
+	search_split = false;
+	int threads = max(search_options.threads, 1);
+	vector<Search_stack> stacks(threads);
+	vector<thread> workers;
+	for (int i = 0; i < threads; i++)
+		workers.push_back(thread(Fit_probcut_positions, &stacks[i], &job));
+	for (int i = 0; i < threads; i++)
+		workers[i].join();
+	cerr << endl;
+	search_options = saved;
+
+	// least squares line of the deep scores on the shallow ones
+	Probcut fit;
+	for (int stage = 0; stage < MPC_STAGES; stage++) {
+		for (int d = MPC_MIN_DEPTH; d <= depth; d++) {
+			int shallow = Probcut_shallow(d);
+			double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+			vector<pair<int, int> > points;
+			for (size_t i = 0; i < job.positions.size(); i++) {
+				int empties = 64 - Pop_count(job.positions[i].own | job.positions[i].opp);
+				if (min(max((60 - empties) / MPC_STAGE_MOVES, 0), MPC_STAGES - 1) != stage)
+					continue;
+				int x = job.scores[i * (MPC_MAX_DEPTH + 1) + shallow];
+				int y = job.scores[i * (MPC_MAX_DEPTH + 1) + d];
+				if (abs(x) >= WIN_SCORE || abs(y) >= WIN_SCORE)
+					continue; // not searched that deep, or a finished game in reach
+				points.push_back(make_pair(x, y));
+				n++;
+				sx += x;
+				sy += y;
+				sxx += (double)x * x;
+				sxy += (double)x * y;
+			}
+			if (n < MPC_MIN_PAIRS || n * sxx - sx * sx <= 0)
+				continue;
+			double a = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+			double b = (sy - a * sx) / n;
+			double squares = 0;
+			for (size_t k = 0; k < points.size(); k++) {
+				double e = points[k].second - (a * points[k].first + b);
+				squares += e * e;
+			}
+			if (a <= 0.1)
+				continue; // the shallow search says nothing about the deep one
+			Probcut_pair* p = &fit.pairs[stage][d];
+			p->a = (float)a;
+			p->b = (float)b;
+			p->sigma = (float)max(sqrt(squares / (n - 2)), 1.0);
+			char line[120];
+			snprintf(line, sizeof(line), "stage %d depth %d shallow %d a %.3f b %.1f sigma %.1f pairs %d",
+				stage, d, shallow, p->a, p->b, p->sigma, (int)n);
+			cout << line << endl;
+		}
+	}
+	if (!fit.Save(out_path))
+		cerr << "could not write " << out_path << endl;
+}
+
+//maps a book file, entries is left pointing at its moves
+bool Read_book(const char* path, Mapped_file* file, const Book_entry** entries, size_t* count) {
+	if (!file->Open(path) || file->Size() < sizeof(Book_header))
+		return false;
+	const Book_header* h = (const Book_header*)file->Data();
+	if (memcmp(h->magic, "OPBK", 4) != 0 || h->version != 2 || h->count < 0
+		|| file->Size() != sizeof(Book_header) + h->count * sizeof(Book_entry))
+		return false;
+	*entries = (const Book_entry*)(file->Data() + sizeof(Book_header));
+	*count = (size_t)h->count;
+	return true;
+}
+
+Opening_book::Opening_book() {
+	tried = false;
+	entries = 0;
+	count = 0;
+}
+
+void Opening_book::Use_file(const char* path) {
+	this->path = path;
+}
+
+bool Opening_book::Map() {
+	tried = true;
+	if (path.empty() || !Read_book(path.c_str(), &file, &entries, &count)) {
+		entries = 0;
+		count = 0;
+		return false;
+	}
+	return true;
+}
+
+bool Opening_book::Lookup(uint64_t key, int* move, int* score) {
+	if (!tried)
+		Map();
+	size_t lo = 0;
+	size_t hi = count;
+	while (lo < hi) { // first entry with key or a larger one
+		size_t mid = lo + (hi - lo) / 2;
+		if (entries[mid].key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	bool found = false;
+	for (; lo < count && entries[lo].key == key; lo++) {
+		if (!found || entries[lo].score > *score) {
+			*move = entries[lo].move;
+			*score = entries[lo].score;
+			found = true;
+		}
+	}
+	return found;
+}
+
+//key of a position that is already in canonical form, own to move
+uint64_t Book_key(uint64_t own, uint64_t opp) {
+	return Hash_masks(own, opp);
+}
+
+//the book's move for cpuval in b, if the book has the position
+bool Book_move(Board* b, int cpuval, pair<int, int>* move) {
+	Bit_Board bt;
+	bt.Set_squares(b, cpuval);
+	uint64_t own;
+	uint64_t opp;
+	int t = Canonical_form(bt.own, bt.opp, &own, &opp);
+	int sq;
+	int score;
+	if (!opening_book.Lookup(Book_key(own, opp), &sq, &score) || sq >= 64)
+		return false;
+	sq = Transform_square(sq, Inverse_transform(t));
+	if (!(bt.Moves(cpuval) & (1ULL << sq)))
+		return false; // another position with the same key
+	move->first = sq / 8 + 1;
+	move->second = sq % 8 + 1;
+	return true;
+}
+
+bool Book_key_less(const Book_entry& x, const Book_entry& y) {
+	return x.key < y.key;
+}
+
+//the order of the book file
+bool Book_entry_less(const Book_entry& x, const Book_entry& y) {
+	return x.key < y.key || (x.key == y.key && x.move < y.move);
+}
+
+// a position of the book being built, in canonical form and without the history a
+// Bit_Board carries. colours do not matter to the book, own is the side to move
+struct Book_position {
+	uint64_t own;
+	uint64_t opp;
+};
+
+// one move of a Book_position for a builder thread to search
+struct Book_task {
+	int position;
+	int move;
+	int score;
+};
+
+struct Book_job {
+	const vector<Book_position>* positions;
+	vector<Book_task>* tasks;
+	atomic<int> next_task;
+};
+
+//searches the moves of job until there are none left, each to search_options.max_depth
+void Search_book_moves(Search_stack* s, Book_job* job) {
+	Bit_Board b;
+	for (int i = job->next_task++; i < (int)job->tasks->size(); i = job->next_task++) {
+		Book_task* t = &(*job->tasks)[i];
+		const Book_position& p = (*job->positions)[t->position];
+		b.Set_discs(p.own, p.opp, 1);
+		b.Make_move(t->move);
+		s->board.Set_squares(&b);
+		Prepare_search(s);
+		Iterative_deepening(s, 0);
+		t->score = -s->score;
+	}
+}
+
+//adds every position up to plies moves into the game to the book at path, searching
+//each of its moves to depth. the positions come from following, from the start, every
+//move within BOOK_WINDOW of the best one, and symmetric ones are searched once.
+//positions the book already has keep their scores and only have their lines followed
+//further. the moves of one level are searched by search_options.threads threads at once
+void Build_book(const char* path, int plies, int depth) {
+	vector<Book_entry> book;
+	{
+		Mapped_file file;
+		const Book_entry* entries;
+		size_t count;
+		if (Read_book(path, &file, &entries, &count))
+			book.assign(entries, entries + count);
+	}
+	sort(book.begin(), book.end(), Book_entry_less);
+	Search_options saved = search_options;
+	search_options.max_depth = depth;
+	search_options.move_seconds = 1e9;
+	search_options.game_seconds = 0;
+	if (!trans_table.Allocated())
+		trans_table.Resize(TT_DEFAULT_MB);
+	time_manager.Start_move(60);
+	search_stop = false;
+	search_split = false;
+	int threads = max(search_options.threads, 1);
+	vector<Search_stack> stacks(threads);
+	for (int i = 0; i < threads; i++)
+		stacks[i].clock = &time_manager;
+	auto start = chrono::steady_clock::now();
+
+	Bit_Board b;
+	vector<Book_position> level(1);
+	Canonical_form(b.own, b.opp, &level[0].own, &level[0].opp);
+	unordered_set<uint64_t> seen;
+	seen.insert(Book_key(level[0].own, level[0].opp));
+	for (int ply = 0; ply < plies && !level.empty(); ply++) {
+		// moves of the positions the book does not have yet
+		vector<Book_task> tasks;
+		vector<uint64_t> keys(level.size());
+		for (size_t i = 0; i < level.size(); i++) {
+			b.Set_discs(level[i].own, level[i].opp, 1);
+			keys[i] = Book_key(b.own, b.opp);
+			Book_entry probe = { keys[i], 0, 0 };
+			vector<Book_entry>::iterator it = lower_bound(book.begin(), book.end(), probe, Book_key_less);
+			if (it != book.end() && it->key == keys[i])
+				continue;
+			for (uint64_t moves = b.Moves(b.side); moves; moves &= moves - 1) {
+				Book_task t = { (int)i, First_square(moves), 0 };
+				tasks.push_back(t);
+			}
+		}
+
+		Book_job job;
+		job.positions = &level;
+		job.tasks = &tasks;
+		job.next_task = 0;
+		vector<thread> workers;
+		for (int i = 0; i < threads; i++)
+			workers.push_back(thread(Search_book_moves, &stacks[i], &job));
+		for (int i = 0; i < threads; i++)
+			workers[i].join();
+		for (size_t i = 0; i < tasks.size(); i++) {
+			Book_entry e = { keys[tasks[i].position], (uint8_t)tasks[i].move, (int16_t)tasks[i].score };
+			book.push_back(e);
+		}
+		sort(book.begin(), book.end(), Book_entry_less);
+		cerr << "ply " << ply << ": " << level.size() << " positions, " << tasks.size() << " moves searched, "
+			<< book.size() << " in the book" << endl;
+
+		// the next level is reached by the good moves of this one
+		vector<Book_position> next;
+		for (size_t i = 0; i < level.size() && ply + 1 < plies; i++) {
+			Book_entry probe = { keys[i], 0, 0 };
+			vector<Book_entry>::iterator first = lower_bound(book.begin(), book.end(), probe, Book_key_less);
+			vector<Book_entry>::iterator last = first;
+			int best = -INF_SCORE;
+			for (; last != book.end() && last->key == keys[i]; last++)
+				best = max(best, (int)last->score);
+			for (; first != last; first++) {
+				if (first->score < best - BOOK_WINDOW)
+					continue;
+				b.Set_discs(level[i].own, level[i].opp, 1);
+				b.Make_move(first->move);
+				Move_list moves;
+				b.Legal_moves(&moves);
+				if (moves.count == 0)
+					continue; // the game is over
+				if (moves.mask == 0)
+					b.Make_move(PASS);
+				Book_position p;
+				Canonical_form(b.own, b.opp, &p.own, &p.opp);
+				if (!seen.insert(Book_key(p.own, p.opp)).second)
+					continue; // a transposition or reflection of a position already on the way
+				next.push_back(p);
+			}
+		}
+		level.swap(next);
+	}
+
+	Book_header h = { { 'O', 'P', 'B', 'K' }, 2, (int64_t)book.size() };
+	ofstream out(path, ios::binary);
+	out.write((const char*)&h, sizeof(h));
+	if (!book.empty())
+		out.write((const char*)&book[0], book.size() * sizeof(Book_entry));
+	if (!out)
+		cerr << "could not write " << path << endl;
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cerr << book.size() << " book moves in " << seconds << "s" << endl;
+	search_options = saved;
+}
+
+// a position of an analysis file, and the line printed for it once searched
+struct Analysis {
+	int line; // of the file, from 1
+	bool valid;
+	uint64_t own; // discs of the side to move
+	uint64_t opp;
+	int side;
+	string result; // empty until searched
+};
+
+struct Analysis_job {
+	vector<Analysis>* positions;
+	atomic<int> next;
+	mutex lock; // guards printed and the results
+	size_t printed; // results before this one have been printed
+	long long nodes;
+};
+
+//reads a position written as 64 squares, row by row from the top left, and the side
+//to move: X, B or * for black, O or W for white, - or . for empty
+bool Parse_position(const string& text, uint64_t* black, uint64_t* white, int* side) {
+	*black = 0;
+	*white = 0;
+	int sq = 0;
+	size_t i = 0;
+	for (; i < text.size() && sq < 64; i++) {
+		char c = (char)toupper(text[i]);
+		if (isspace((unsigned char)c))
+			continue;
+		if (c == 'X' || c == 'B' || c == '*')
+			*black |= 1ULL << sq;
+		else if (c == 'O' || c == 'W')
+			*white |= 1ULL << sq;
+		else if (c != '-' && c != '.')
+			return false;
+		sq++;
+	}
+	while (i < text.size() && isspace((unsigned char)text[i]))
+		i++;
+	if (sq < 64 || i == text.size())
+		return false;
+	char c = (char)toupper(text[i]);
+	if (c == 'X' || c == 'B' || c == '*')
+		*side = 1;
+	else if (c == 'O' || c == 'W')
+		*side = -1;
+	else
+		return false;
+	return true;
+}
+
+//searches the positions of job until there are none left, each on its own clock, and
+//prints every result that is next in file order
+void Analyze_positions(Search_stack* s, Analysis_job* job) {
+	Time_manager clock;
+	Bit_Board b;
+	for (int i = job->next++; i < (int)job->positions->size(); i = job->next++) {
+		Analysis* a = &(*job->positions)[i];
+		ostringstream out;
+		out << "line " << a->line;
+		long long nodes = 0;
+		if (!a->valid)
+			out << " error bad position";
+		else {
+			b.Set_discs(a->own, a->opp, a->side);
+			clock.Start_move(b.empties);
+			Move_list moves;
+			b.Legal_moves(&moves);
+			if (moves.count == 0)
+				out << " move none score " << Final_score(&b) << " depth 0 nodes 0 time 0";
+			else {
+				s->board.Set_squares(&b);
+				s->clock = &clock;
+				Prepare_search(s);
+				Iterative_deepening(s, 0);
+				nodes = s->nodes;
+				out << " move ";
+				if (s->best_move == PASS)
+					out << "pass";
+				else if (s->best_move == NO_MOVE)
+					out << "none";
+				else
+					out << s->best_move / 8 + 1 << "," << s->best_move % 8 + 1;
+				out << " score " << s->score << " depth " << s->completed_depth << " nodes " << nodes
+					<< " time " << clock.Elapsed();
+			}
+		}
+
+		lock_guard<mutex> hold(job->lock);
+		a->result = out.str();
+		job->nodes += nodes;
+		vector<Analysis>& p = *job->positions;
+		for (; job->printed < p.size() && !p[job->printed].result.empty(); job->printed++) {
+			cout << p[job->printed].result << "\n";
+			string().swap(p[job->printed].result); // printed, the memory can go
+		}
+		cout << flush;
+	}
+}
+
+//searches every position of the file at path to search_options.max_depth or for
+//search_options.move_seconds, threads positions at a time, and prints one line for
+//each in the order of the file
+void Analyze(const char* path, int threads) {
+	ifstream in(path);
+	if (!in) {
+		cerr << "could not open " << path << endl;
+		return;
+	}
+	vector<Analysis> positions;
+	string text;
+	for (int line = 1; getline(in, text); line++) {
+		size_t start = text.find_first_not_of(" \t\r");
+		if (start == string::npos || text[start] == '#')
+			continue; // blank lines and comments
+		Analysis a;
+		uint64_t black;
+		uint64_t white;
+		a.line = line;
+		a.side = 1;
+		a.valid = Parse_position(text, &black, &white, &a.side) && (black & white) == 0;
+		a.own = a.side == 1 ? black : white;
+		a.opp = a.side == 1 ? white : black;
+		positions.push_back(a);
+	}
+
+	Search_options saved = search_options;
+	search_options.game_seconds = 0;
+	if (!trans_table.Allocated())
+		trans_table.Resize(TT_DEFAULT_MB);
+	search_stop = false;
+	search_split = false;
+	Analysis_job job;
+	job.positions = &positions;
+	job.next = 0;
+	job.printed = 0;
+	job.nodes = 0;
+	threads = max(min(threads, (int)positions.size()), 1);
+	vector<Search_stack> stacks(threads);
+	vector<thread> workers;
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < threads; i++)
+		workers.push_back(thread(Analyze_positions, &stacks[i], &job));
+	for (int i = 0; i < threads; i++)
+		workers[i].join();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cerr << positions.size() << " positions, " << job.nodes << " nodes in " << seconds << "s on " << threads
+		<< " threads, " << (long long)(job.nodes / max(seconds, 1e-6)) << " nodes/s" << endl;
+	search_options = saved;
+}
+
+//the squares of b and the side to move, as Parse_position reads them
+string Position_string(Bit_Board* b) {
+	string text;
+	for (int sq = 0; sq < 64; sq++) {
+		int v = b->Get_square(sq / 8 + 1, sq % 8 + 1);
+		text += v == 1 ? 'X' : v == -1 ? 'O' : '-';
+	}
+	text += b->side == 1 ? " X" : " O";
+	return text;
+}
+
+//leaves of the game tree depth moves below b. a pass counts as a move, a finished
+//game as a leaf however much depth is left
+long long Perft(Bit_Board* b, int depth) {
+	if (depth == 0)
+		return 1;
+	uint64_t moves = b->Moves(b->side);
+	if (moves == 0) {
+		if (!b->Has_valid_move(-1 * b->side))
+			return 1;
+		b->Make_move(PASS);
+		long long n = Perft(b, depth - 1);
+		b->Unmake_move();
+		return n;
+	}
+	if (depth == 1)
+		return Pop_count(moves);
+	long long n = 0;
+	for (; moves; moves &= moves - 1) {
+		b->Make_move(First_square(moves));
+		n += Perft(b, depth - 1);
+		b->Unmake_move();
+	}
+	return n;
+}
+
+//Perft with the square by square Board, val to move
+long long Perft_reference(Board* b, int val, int depth) {
+	if (depth == 0)
+		return 1;
+	if (!b->Has_valid_move(val)) {
+		if (!b->Has_valid_move(-1 * val))
+			return 1;
+		return Perft_reference(b, -1 * val, depth - 1);
+	}
+	long long n = 0;
+	for (int i = 1; i < 9; i++) {
+		for (int j = 1; j < 9; j++) {
+			if (b->Move_is_valid(i, j, val)) {
+				Board c;
+				c.Set_squares(b);
+				c.Play_square(i, j, val);
+				n += Perft_reference(&c, -1 * val, depth - 1);
+			}
+		}
+	}
+	return n;
+}
+
+//the squares of m as row,col pairs
+string Square_list(uint64_t m) {
+	ostringstream out;
+	for (; m; m &= m - 1)
+		out << " " << First_square(m) / 8 + 1 << "," << First_square(m) % 8 + 1;
+	return out.str();
+}
+
+//Perft of ref and b side by side, which must hold the same position. every node
+//compares their valid moves and every move the position it leads to; the first
+//difference is printed and ends the walk with ok false
+long long Perft_check(Board* ref, Bit_Board* b, int depth, bool* ok) {
+	if (depth == 0)
+		return 1;
+	int val = b->side;
+	uint64_t ref_moves = 0;
+	for (int sq = 0; sq < 64; sq++)
+		if (ref->Move_is_valid(sq / 8 + 1, sq % 8 + 1, val))
+			ref_moves |= 1ULL << sq;
+	Move_list list;
+	b->Legal_moves(&list);
+	uint64_t moves = list.mask;
+	if (moves != ref_moves || (list.count == 0) != (moves == 0 && !ref->Has_valid_move(-1 * val))) {
+		cout << "moves differ in " << Position_string(b) << endl
+			<< "  Board:    " << Square_list(ref_moves) << endl
+			<< "  Bit_Board:" << Square_list(moves) << (list.count == 1 && moves == 0 ? " pass" : "") << endl;
+		*ok = false;
+		return 0;
+	}
+	if (list.count == 0)
+		return 1;
+	if (moves == 0) {
+		b->Make_move(PASS);
+		long long n = Perft_check(ref, b, depth - 1, ok);
+		b->Unmake_move();
+		return n;
+	}
+
+	long long n = 0;
+	for (; moves && *ok; moves &= moves - 1) {
+		int sq = First_square(moves);
+		Board c;
+		c.Set_squares(ref);
+		c.Play_square(sq / 8 + 1, sq % 8 + 1, val);
+		uint64_t ref_flips = 0;
+		for (int k = 0; k < 64; k++)
+			if (k != sq && c.Get_square(k / 8 + 1, k % 8 + 1) != ref->Get_square(k / 8 + 1, k % 8 + 1))
+				ref_flips |= 1ULL << k;
+		string before = Position_string(b);
+		b->Make_move(sq);
+		if (b->history[b->moves_made - 1].flips != ref_flips) {
+			cout << "flips of " << sq / 8 + 1 << "," << sq % 8 + 1 << " differ in " << before << endl
+				<< "  Board:    " << Square_list(ref_flips) << endl
+				<< "  Bit_Board:" << Square_list(b->history[b->moves_made - 1].flips) << endl;
+			*ok = false;
+		}
+		else
+			n += Perft_check(&c, b, depth - 1, ok);
+		b->Unmake_move();
+	}
+	return n;
+}
+
+//leaf counts and speed of every depth up to depth from position, the start position
+//if it is 0. with check the move generation of Bit_Board is also compared move by
+//move against Board's, whose own speed is reported alongside
+void Perft_report(int depth, const char* position, bool check) {
+	Bit_Board b;
+	if (position) {
+		uint64_t black;
+		uint64_t white;
+		int side;
+		if (!Parse_position(position, &black, &white, &side) || (black & white) != 0) {
+			cerr << "bad position " << position << endl;
+			return;
+		}
+		b.Set_discs(side == 1 ? black : white, side == 1 ? white : black, side);
+	}
+	Board ref;
+	ref.Set_discs(b.Discs(1), b.Discs(-1));
+
+	for (int d = 1; d <= depth; d++) {
+		auto start = chrono::steady_clock::now();
+		long long n = Perft(&b, d);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		cout << "depth " << d << " leaves " << n << " time " << seconds << "s "
+			<< (long long)(n / max(seconds, 1e-9)) << " leaves/s";
+		if (check) {
+			bool ok = true;
+			start = chrono::steady_clock::now();
+			long long ref_n = Perft_reference(&ref, b.side, d);
+			double ref_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			cout << ", Board " << ref_n << " in " << ref_seconds << "s" << endl;
+			Perft_check(&ref, &b, d, &ok);
+			if (!ok || ref_n != n) {
+				cout << "mismatch at depth " << d << endl;
+				return;
+			}
+		}
+		else
+			cout << endl;
+	}
+	if (check)
+		cout << "Board and Bit_Board agree" << endl;
+}
+
+// the positions a benchmark runs its primitive over, the same every run
+struct Bench_corpus {
+	vector<Board> boards;
+	vector<int> sides; // to move in boards[i]
+	vector<Bit_Board> bit_boards; // the same positions
+};
+
+// times one primitive: goes over the corpus once and returns how many calls it made.
+// what the calls return goes into bench_sink so they can not be optimized away
+typedef long long (*Bench_function)(Bench_corpus* c);
+
+volatile long long bench_sink;
+
+long long Bench_board_move_is_valid(Bench_corpus* c) {
+	long long sum = 0;
+	for (size_t p = 0; p < c->boards.size(); p++)
+		for (int i = 1; i < 9; i++)
+			for (int j = 1; j < 9; j++)
+				sum += c->boards[p].Move_is_valid(i, j, c->sides[p]);
+	bench_sink += sum;
+	return (long long)c->boards.size() * 64;
+}
+
+long long Bench_board_check_or_flip_path(Bench_corpus* c) {
+	long long sum = 0;
+	long long calls = 0;
+	for (size_t p = 0; p < c->boards.size(); p++)
+		for (int r = 0; r < 8; r++)
+			for (int col = 0; col < 8; col++)
+				if (c->boards[p].Get_square(r + 1, col + 1) == 0)
+					for (int rinc = -1; rinc <= 1; rinc++)
+						for (int cinc = -1; cinc <= 1; cinc++, calls++)
+							sum += c->boards[p].Check_or_flip_path(r, col, rinc, cinc, c->sides[p], false);
+	bench_sink += sum;
+	return calls;
+}
+
+//every valid move played on a copy, so it includes one Set_squares per call
+long long Bench_board_play_square(Bench_corpus* c) {
+	long long sum = 0;
+	long long calls = 0;
+	Board scratch;
+	for (size_t p = 0; p < c->boards.size(); p++) {
+		for (uint64_t m = c->bit_boards[p].Moves(c->sides[p]); m; m &= m - 1, calls++) {
+			scratch.Set_squares(&c->boards[p]);
+			sum += scratch.Play_square(First_square(m) / 8 + 1, First_square(m) % 8 + 1, c->sides[p]);
+		}
+	}
+	bench_sink += sum + scratch.Get_square(1, 1);
+	return calls;
+}
+
+long long Bench_board_has_valid_move(Bench_corpus* c) {
+	long long sum = 0;
+	for (size_t p = 0; p < c->boards.size(); p++)
+		sum += c->boards[p].Has_valid_move(1) + c->boards[p].Has_valid_move(-1);
+	bench_sink += sum;
+	return (long long)c->boards.size() * 2;
+}
+
+long long Bench_board_full_board(Bench_corpus* c) {
+	long long sum = 0;
+	for (size_t p = 0; p < c->boards.size(); p++)
+		sum += c->boards[p].Full_board();
+	bench_sink += sum;
+	return (long long)c->boards.size();
+}
+
+long long Bench_board_score(Bench_corpus* c) {
+	long long sum = 0;
+	for (size_t p = 0; p < c->boards.size(); p++)
+		sum += c->boards[p].Score();
+	bench_sink += sum;
+	return (long long)c->boards.size();
+}
+
+long long Bench_board_eval(Bench_corpus* c) {
+	long long sum = 0;
+	for (size_t p = 0; p < c->boards.size(); p++)
+		sum += c->boards[p].Eval(c->sides[p], 0);
+	bench_sink += sum;
+	return (long long)c->boards.size();
+}
+
+long long Bench_board_free_neighbors(Bench_corpus* c) {
+	long long sum = 0;
+	for (size_t p = 0; p < c->boards.size(); p++)
+		for (int i = 1; i < 9; i++)
+			for (int j = 1; j < 9; j++)
+				sum += c->boards[p].Free_neighbors(i, j);
+	bench_sink += sum;
+	return (long long)c->boards.size() * 64;
+}
+
+long long Bench_board_set_squares(Bench_corpus* c) {
+	Board scratch;
+	for (size_t p = 0; p < c->boards.size(); p++)
+		scratch.Set_squares(&c->boards[p]);
+	bench_sink += scratch.Get_square(4, 4);
+	return (long long)c->boards.size();
+}
+
+long long Bench_bit_move_is_valid(Bench_corpus* c) {
+	long long sum = 0;
+	for (size_t p = 0; p < c->bit_boards.size(); p++)
+		for (int i = 1; i < 9; i++)
+			for (int j = 1; j < 9; j++)
+				sum += c->bit_boards[p].Move_is_valid(i, j, c->sides[p]);
+	bench_sink += sum;
+	return (long long)c->bit_boards.size() * 64;
+}
+
+long long Bench_bit_moves(Bench_corpus* c) {
+	long long sum = 0;
+	for (size_t p = 0; p < c->bit_boards.size(); p++)
+		sum += (long long)c->bit_boards[p].Moves(c->sides[p]);
+	bench_sink += sum;
+	return (long long)c->bit_boards.size();
+}
+
+long long Bench_bit_get_flips(Bench_corpus* c) {
+	long long sum = 0;
+	long long calls = 0;
+	for (size_t p = 0; p < c->bit_boards.size(); p++) {
+		Bit_Board* b = &c->bit_boards[p];
+		for (uint64_t m = b->Moves(b->side); m; m &= m - 1, calls++)
+			sum += (long long)Get_flips(b->own, b->opp, First_square(m));
+	}
+	bench_sink += sum;
+	return calls;
+}
+
+//one call is a Make_move and the Unmake_move taking it back
+long long Bench_bit_make_unmake(Bench_corpus* c) {
+	long long sum = 0;
+	long long calls = 0;
+	for (size_t p = 0; p < c->bit_boards.size(); p++) {
+		Bit_Board* b = &c->bit_boards[p];
+		for (uint64_t m = b->Moves(b->side); m; m &= m - 1, calls++) {
+			b->Make_move(First_square(m));
+			sum += b->own_count;
+			b->Unmake_move();
+		}
+	}
+	bench_sink += sum;
+	return calls;
+}
+
+long long Bench_bit_has_valid_move(Bench_corpus* c) {
+	long long sum = 0;
+	for (size_t p = 0; p < c->bit_boards.size(); p++)
+		sum += c->bit_boards[p].Has_valid_move(1) + c->bit_boards[p].Has_valid_move(-1);
+	bench_sink += sum;
+	return (long long)c->bit_boards.size() * 2;
+}
+
+long long Bench_bit_full_board(Bench_corpus* c) {
+	long long sum = 0;
+	for (size_t p = 0; p < c->bit_boards.size(); p++)
+		sum += c->bit_boards[p].Full_board();
+	bench_sink += sum;
+	return (long long)c->bit_boards.size();
+}
+
+long long Bench_bit_score(Bench_corpus* c) {
+	long long sum = 0;
+	for (size_t p = 0; p < c->bit_boards.size(); p++)
+		sum += c->bit_boards[p].Score();
+	bench_sink += sum;
+	return (long long)c->bit_boards.size();
+}
+
+long long Bench_bit_eval(Bench_corpus* c) {
+	long long sum = 0;
+	for (size_t p = 0; p < c->bit_boards.size(); p++)
+		sum += c->bit_boards[p].Eval(c->sides[p], 0);
+	bench_sink += sum;
+	return (long long)c->bit_boards.size();
+}
+
+long long Bench_bit_free_neighbors(Bench_corpus* c) {
+	long long sum = 0;
+	for (size_t p = 0; p < c->bit_boards.size(); p++)
+		for (int i = 1; i < 9; i++)
+			for (int j = 1; j < 9; j++)
+				sum += c->bit_boards[p].Free_neighbors(i, j);
+	bench_sink += sum;
+	return (long long)c->bit_boards.size() * 64;
+}
+
+//from a Board, as Minimax_decision does for every move
+long long Bench_bit_set_squares(Bench_corpus* c) {
+	Bit_Board scratch;
+	for (size_t p = 0; p < c->boards.size(); p++)
+		scratch.Set_squares(&c->boards[p], c->sides[p]);
+	bench_sink += (long long)scratch.hash;
+	return (long long)c->boards.size();
+}
+
+struct Bench_case {
+	const char* name;
+	Bench_function run;
+};
+
+static const Bench_case bench_cases[] = {
+	{ "Board::Move_is_valid", Bench_board_move_is_valid },
+	{ "Board::Check_or_flip_path", Bench_board_check_or_flip_path },
+	{ "Board::Play_square", Bench_board_play_square },
+	{ "Board::Has_valid_move", Bench_board_has_valid_move },
+	{ "Board::Full_board", Bench_board_full_board },
+	{ "Board::Score", Bench_board_score },
+	{ "Board::Eval", Bench_board_eval },
+	{ "Board::Free_neighbors", Bench_board_free_neighbors },
+	{ "Board::Set_squares", Bench_board_set_squares },
+	{ "Bit_Board::Move_is_valid", Bench_bit_move_is_valid },
+	{ "Bit_Board::Moves", Bench_bit_moves },
+	{ "Get_flips", Bench_bit_get_flips },
+	{ "Bit_Board::Make_move+Unmake_move", Bench_bit_make_unmake },
+	{ "Bit_Board::Has_valid_move", Bench_bit_has_valid_move },
+	{ "Bit_Board::Full_board", Bench_bit_full_board },
+	{ "Bit_Board::Score", Bench_bit_score },
+	{ "Bit_Board::Eval", Bench_bit_eval },
+	{ "Bit_Board::Free_neighbors", Bench_bit_free_neighbors },
+	{ "Bit_Board::Set_squares", Bench_bit_set_squares },
+};
+
+//ns per call of every primitive in bench_cases over positions midgame positions, as the
+//mean, standard deviation and minimum of BENCH_SAMPLES timed passes. with path set the
+//results also go there as one json object per line, for comparing commits
+void Bench_report(int positions, const char* path) {
+	Bench_corpus c;
+	mt19937 gen(20240701);
+	for (int p = 0; p < positions; p++) {
+		Board b;
+		Random_position(&b, 20 + p % 21, &gen); // 20 to 40 moves in
+		Bit_Board bt;
+		bt.Set_squares(&b, 1);
+		int side = bt.Has_valid_move(1) || !bt.Has_valid_move(-1) ? 1 : -1; // someone who can move, if anyone
+		if (side == -1)
+			bt.Swap();
+		c.boards.push_back(b);
+		c.sides.push_back(side);
+		c.bit_boards.push_back(bt);
+	}
+
+	ofstream json;
+	if (path) {
+		json.open(path);
+		if (!json) {
+			cerr << "could not open " << path << endl;
+			return;
+		}
+	}
+	cout << "primitive                          ns/call    stddev       min     calls/pass" << endl;
+	for (size_t k = 0; k < sizeof(bench_cases) / sizeof(bench_cases[0]); k++) {
+		const Bench_case& bench = bench_cases[k];
+		long long calls = bench.run(&c); // warms the caches and branch predictors
+		double ns[BENCH_SAMPLES];
+		double mean = 0;
+		double low = 1e18;
+		for (int i = 0; i < BENCH_SAMPLES; i++) {
+			auto start = chrono::steady_clock::now();
+			bench.run(&c);
+			ns[i] = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / max(calls, 1LL);
+			mean += ns[i] / BENCH_SAMPLES;
+			low = min(low, ns[i]);
+		}
+		double variance = 0;
+		for (int i = 0; i < BENCH_SAMPLES; i++)
+			variance += (ns[i] - mean) * (ns[i] - mean) / (BENCH_SAMPLES - 1);
+		double deviation = sqrt(variance);
+
+		char line[160];
+		snprintf(line, sizeof(line), "%-32s %9.2f %9.2f %9.2f %14lld", bench.name, mean, deviation, low, calls);
+		cout << line << endl;
+		if (path)
+			json << "{\"primitive\":\"" << bench.name << "\",\"ns_per_call\":" << mean << ",\"stddev\":" << deviation
+				<< ",\"min\":" << low << ",\"calls_per_pass\":" << calls << ",\"passes\":" << BENCH_SAMPLES
+				<< ",\"positions\":" << positions << "}" << endl;
+	}
+}
+
+// one side of a match, see Parse_engine
+struct Match_engine {
+	string spec; // as given, for the report
+	Pattern_eval weights; // not loaded plays the hand made Eval
+	int depth;
+	long long nodes; // 0 for no limit
+	double seconds; // per move
+	double probcut_t; // 0 searches full width
+	Trans_table table; // its own, so one engine's scores never reach the other
+};
+
+// start of a match game
+struct Match_opening {
+	uint64_t own;
+	uint64_t opp;
+	int side; // to move, the discs in own
+};
+
+// what the match threads share
+struct Match_job {
+	Match_engine engines[2]; // [0] is the one the results are counted for
+	vector<Match_opening> openings;
+	int games;
+	atomic<int> next_game;
+	atomic<bool> stop; // the sprt reached a verdict, no new games
+	mutex lock; // guards the counts
+	int wins;
+	int draws;
+	int losses;
+	bool sprt;
+	double elo0; // elo difference of the null hypothesis
+	double elo1; // and of the alternative
+};
+
+//reads "key=value,key=value" into e. weights=file or none for the hand made Eval,
+//depth=plies, nodes=n, time=seconds per move and probcut=t. without any limit a move gets
+//MATCH_MOVE_SECONDS. weights not given are the ones loaded now
+bool Parse_engine(const string& spec, Match_engine* e) {
+	e->spec = spec;
+	e->weights = pattern_eval;
+	e->depth = MAX_PLY;
+	e->nodes = 0;
+	e->seconds = 0;
+	e->probcut_t = search_options.probcut_t;
+	stringstream in(spec);
+	string item;
+	while (getline(in, item, ',')) {
+		size_t eq = item.find('=');
+		if (eq == string::npos)
+			return false;
+		string key = item.substr(0, eq);
+		string value = item.substr(eq + 1);
+		if (key == "weights") {
+			if (value == "none")
+				e->weights = Pattern_eval();
+			else if (!e->weights.Load(value.c_str())) {
+				cerr << "could not read weights from " << value << endl;
+				return false;
+			}
+		}
+		else if (key == "depth")
+			e->depth = min(max(atoi(value.c_str()), 1), MAX_PLY);
+		else if (key == "nodes")
+			e->nodes = max(atoll(value.c_str()), 1LL);
+		else if (key == "time")
+			e->seconds = max(atof(value.c_str()), 0.001);
+		else if (key == "probcut")
+			e->probcut_t = max(atof(value.c_str()), 0.0);
+		else
+			return false;
+	}
+	if (e->seconds == 0)
+		e->seconds = e->depth == MAX_PLY && e->nodes == 0 ? MATCH_MOVE_SECONDS : 1e9;
+	e->table.Resize(TT_DEFAULT_MB);
+	return true;
+}
+
+//every position MATCH_OPENING_PLIES moves in, one of each set of symmetric copies,
+//in an order shuffled with a fixed seed so every match plays the same ones
+void Match_openings(Bit_Board* b, int plies, unordered_set<uint64_t>* seen, vector<Match_opening>* out) {
+	if (plies == 0) {
+		Match_opening o;
+		Canonical_form(b->own, b->opp, &o.own, &o.opp);
+		o.side = b->side;
+		if (seen->insert(Book_key(o.own, o.opp)).second)
+			out->push_back(o);
+		return;
+	}
+	for (uint64_t moves = b->Moves(b->side); moves; moves &= moves - 1) {
+		b->Make_move(First_square(moves));
+		Match_openings(b, plies - 1, seen, out);
+		b->Unmake_move();
+	}
+}
+
+//elo difference a score between 0 and 1 stands for
+double Elo_of(double score) {
+	score = min(max(score, 0.001), 0.999);
+	return -400 * log10(1 / score - 1);
+}
+
+//score and the elo difference with its 95% error margin of wins, draws and losses
+void Match_elo(int wins, int draws, int losses, double* score, double* elo, double* margin) {
+	int n = max(wins + draws + losses, 1);
+	double m = (wins + draws / 2.0) / n;
+	double variance = (wins * (1 - m) * (1 - m) + draws * (0.5 - m) * (0.5 - m) + losses * m * m) / n;
+	double error = 1.96 * sqrt(variance / n);
+	*score = m;
+	*elo = Elo_of(m);
+	*margin = (Elo_of(m + error) - Elo_of(m - error)) / 2;
+}
+
+//log likelihood ratio of elo1 over elo0, with the game results taken as normally
+//distributed around their mean (the usual approximation of the trinomial sprt)
+double Sprt_llr(int wins, int draws, int losses, double elo0, double elo1) {
+	int n = wins + draws + losses;
+	if (n == 0 || wins + draws == 0 || draws + losses == 0)
+		return 0; // no variance yet
+	double m = (wins + draws / 2.0) / n;
+	double variance = (wins * (1 - m) * (1 - m) + draws * (0.5 - m) * (0.5 - m) + losses * m * m) / n;
+	double s0 = 1 / (1 + pow(10.0, -elo0 / 400));
+	double s1 = 1 / (1 + pow(10.0, -elo1 / 400));
+	return n * (s1 - s0) * (2 * m - s0 - s1) / (2 * variance);
+}
+
+//plays games of job until there are none left or the sprt is done. games 2k and
+//2k + 1 start from opening k, with engines[0] black in the first and white in the second
+void Play_match_games(Search_stack* s, Match_job* job) {
+	Time_manager clock;
+	Bit_Board b;
+	for (int game = job->next_game++; game < job->games && !job->stop; game = job->next_game++) {
+		const Match_opening& o = job->openings[game / 2 % job->openings.size()];
+		int first_side = game % 2 == 0 ? 1 : -1; // engines[0] plays this colour
+		b.Set_discs(o.own, o.opp, o.side);
+		while (true) {
+			Move_list moves;
+			b.Legal_moves(&moves);
+			if (moves.count == 0)
+				break;
+			int sq = moves.list[0]; // PASS when that is all there is
+			if (moves.count > 1) {
+				Match_engine* e = &job->engines[b.side == first_side ? 0 : 1];
+				s->board.Set_squares(&b);
+				s->clock = &clock;
+				Prepare_search(s);
+				s->depth_limit = e->depth;
+				s->node_limit = e->nodes;
+				s->table = &e->table;
+				s->eval = &e->weights;
+				s->probcut_t = e->probcut_t;
+				clock.Start_fixed(e->seconds);
+				Iterative_deepening(s, 0);
+				if (s->best_move != NO_MOVE)
+					sq = s->best_move;
+			}
+			b.Make_move(sq);
+		}
+
+		int margin = first_side * b.Score();
+		lock_guard<mutex> hold(job->lock);
+		if (margin > 0)
+			job->wins++;
+		else if (margin == 0)
+			job->draws++;
+		else
+			job->losses++;
+		int played = job->wins + job->draws + job->losses;
+		double llr = Sprt_llr(job->wins, job->draws, job->losses, job->elo0, job->elo1);
+		bool done = job->sprt && (llr <= log(SPRT_BETA / (1 - SPRT_ALPHA)) || llr >= log((1 - SPRT_BETA) / SPRT_ALPHA));
+		if (done)
+			job->stop = true;
+		if (played % 20 == 0 || played == job->games || done) {
+			double score, elo, error;
+			Match_elo(job->wins, job->draws, job->losses, &score, &elo, &error);
+			char line[200];
+			snprintf(line, sizeof(line), "games %d +%d =%d -%d score %.1f%% elo %.1f +- %.1f",
+				played, job->wins, job->draws, job->losses, 100 * score, elo, error);
+			cerr << line;
+			if (job->sprt)
+				cerr << " llr " << llr;
+			cerr << endl;
+		}
+	}
+}
+
+//plays games games of the engine of spec_a against the one of spec_b, search_options.threads
+//at a time, and prints the wins, draws and losses of a with the elo difference. with
+//sprt set it stops once the sprt of elo0 against elo1 accepts one of them. the
+//openings are read from openings_path, one position per line as -analyze takes them,
+//or else made from every position MATCH_OPENING_PLIES moves in
+void Match(int games, const string& spec_a, const string& spec_b, bool sprt, double elo0, double elo1, const char* openings_path) {
+	Match_job job;
+	if (!Parse_engine(spec_a, &job.engines[0]) || !Parse_engine(spec_b, &job.engines[1])) {
+		cerr << "bad engine, expected key=value,... with keys weights, depth, nodes and time" << endl;
+		return;
+	}
+	if (openings_path) {
+		ifstream in(openings_path);
+		if (!in) {
+			cerr << "could not open " << openings_path << endl;
+			return;
+		}
+		string text;
+		while (getline(in, text)) {
+			uint64_t black;
+			uint64_t white;
+			int side = 1;
+			if (!Parse_position(text, &black, &white, &side) || (black & white) != 0)
+				continue; // blank lines, comments and anything else that is not a position
+			Match_opening o = { side == 1 ? black : white, side == 1 ? white : black, side };
+			job.openings.push_back(o);
+		}
+	}
+	else {
+		Bit_Board b;
+		unordered_set<uint64_t> seen;
+		Match_openings(&b, MATCH_OPENING_PLIES, &seen, &job.openings);
+		mt19937 gen(20241001);
+		shuffle(job.openings.begin(), job.openings.end(), gen);
+	}
+	if (job.openings.empty()) {
+		cerr << "no openings" << endl;
+		return;
+	}
+
+	Search_options saved = search_options;
+	search_options.game_seconds = 0;
+	search_stop = false;
+	search_split = false;
+	job.games = games;
+	job.next_game = 0;
+	job.stop = false;
+	job.wins = 0;
+	job.draws = 0;
+	job.losses = 0;
+	job.sprt = sprt;
+	job.elo0 = elo0;
+	job.elo1 = elo1;
+	int threads = max(search_options.threads, 1);
+	cerr << "a: " << spec_a << endl << "b: " << spec_b << endl << games << " games from " << job.openings.size()
+		<< " openings on " << threads << " threads" << endl;
+	vector<Search_stack> stacks(threads);
+	vector<thread> workers;
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < threads; i++)
+		workers.push_back(thread(Play_match_games, &stacks[i], &job));
+	for (int i = 0; i < threads; i++)
+		workers[i].join();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	double score, elo, error;
+	Match_elo(job.wins, job.draws, job.losses, &score, &elo, &error);
+	char line[200];
+	snprintf(line, sizeof(line), "a +%d =%d -%d score %.1f%% elo %.1f +- %.1f in %.0fs",
+		job.wins, job.draws, job.losses, 100 * score, elo, error, seconds);
+	cout << line << endl;
+	if (sprt) {
+		double llr = Sprt_llr(job.wins, job.draws, job.losses, elo0, elo1);
+		cout << "sprt elo0 " << elo0 << " elo1 " << elo1 << " llr " << llr << " bounds " << log(SPRT_BETA / (1 - SPRT_ALPHA))
+			<< " " << log((1 - SPRT_BETA) / SPRT_ALPHA) << ": ";
+		if (llr >= log((1 - SPRT_BETA) / SPRT_ALPHA))
+			cout << "H1 accepted, a is stronger by at least elo1" << endl;
+		else if (llr <= log(SPRT_BETA / (1 - SPRT_ALPHA)))
+			cout << "H0 accepted, a is no stronger than elo0" << endl;
+		else
+			cout << "no verdict yet, play more games" << endl;
+	}
+	search_options = saved;
+}
+
+//square as othello programs write it, column letter and row number, PA for a pass
+string Square_name(int sq) {
+	if (sq == PASS)
+		return "PA";
+	string name;
+	name += (char)('A' + sq % 8);
+	name += (char)('1' + sq / 8);
+	return name;
+}
+
+//reads F5, f5 or PA, anything after a / is left out (evals and times of game records)
+int Parse_square(const string& text) {
+	string name = text.substr(0, text.find('/'));
+	if (name.size() == 2 && toupper(name[0]) == 'P' && toupper(name[1]) == 'A')
+		return PASS;
+	if (name.size() != 2)
+		return NO_MOVE;
+	int col = toupper(name[0]) - 'A';
+	int row = name[1] - '1';
+	if (col < 0 || col > 7 || row < 0 || row > 7)
+		return NO_MOVE;
+	return row * 8 + col;
+}
+
+//plays sq for the side to move of b, passing first if only the other side can
+//move. false if it is not a valid move
+bool Protocol_move(Bit_Board* b, int sq) {
+	if (sq == NO_MOVE)
+		return false;
+	Move_list moves;
+	b->Legal_moves(&moves);
+	if (moves.count == 0)
+		return false; // the game is over
+	if (sq == PASS) {
+		if (moves.mask != 0)
+			return false;
+		b->Make_move(PASS);
+		return true;
+	}
+	if (moves.mask == 0) {
+		b->Make_move(PASS); // the pass was left out
+		b->Legal_moves(&moves);
+	}
+	if (!(moves.mask & (1ULL << sq)))
+		return false;
+	b->Make_move(sq);
+	return true;
+}
+
+//reads a ggf game record, (;GM[Othello]...BO[8 squares side]B[F5]W[D6]...;), into b:
+//the start position of BO and then every move. false if it does not hold a game
+bool Parse_game(const string& ggf, Bit_Board* b) {
+	size_t start = ggf.find("BO[");
+	size_t end = start == string::npos ? string::npos : ggf.find(']', start);
+	if (end == string::npos)
+		return false;
+	string board = ggf.substr(start + 3, end - start - 3);
+	size_t size = board.find_first_not_of(" ");
+	if (size == string::npos || board.compare(size, 2, "8 ") != 0)
+		return false; // only 8x8 boards
+	uint64_t black;
+	uint64_t white;
+	int side = 1;
+	if (!Parse_position(board.substr(size + 2), &black, &white, &side) || (black & white) != 0)
+		return false;
+	b->Set_discs(side == 1 ? black : white, side == 1 ? white : black, side);
+
+	// moves are B[..] and W[..] tags, other tags with those letters are longer (PB, PW)
+	for (size_t i = end; (i = ggf.find('[', i + 1)) != string::npos; ) {
+		char tag = ggf[i - 1];
+		if ((tag != 'B' && tag != 'W') || (i >= 2 && isalpha((unsigned char)ggf[i - 2])))
+			continue;
+		size_t close = ggf.find(']', i);
+		if (close == string::npos)
+			return false;
+		if ((tag == 'B') != (b->side == 1) && b->Moves(b->side) == 0)
+			b->Make_move(PASS); // the record left out a pass
+		if (!Protocol_move(b, Parse_square(ggf.substr(i + 1, close - i - 1))))
+			return false;
+	}
+	return true;
+}
+
+//a score of the search in discs for the side to move: the margin of a solved game, or
+//the heuristic scaled the way Pattern_eval scales it. the hand terms Bit_Board::Eval
+//uses without weights have no disc scale and go out as they are
+double Score_discs(int score) {
+	if (score >= WIN_SCORE)
+		return score - WIN_SCORE;
+	if (score <= -WIN_SCORE)
+		return score + WIN_SCORE;
+	if (!pattern_eval.Loaded())
+		return score;
+	return (double)score / EVAL_DISC;
+}
+
+//the line from the root of s along an iteration's pv, as hint and status lines give
+//it. where a table hit cut the pv short, the best moves stored in the table go on
+string Pv_text(Search_stack* s, Iteration_stats* it) {
+	Bit_Board b;
+	b.Set_squares(&s->board);
+	string pv;
+	int length = 0;
+	for (; length < it->pv_length; length++) {
+		pv += (length > 0 ? "-" : "") + Square_name(it->pv[length]);
+		b.Make_move(it->pv[length]);
+	}
+	Tt_counters tt = {}; // not counted with the search's own probes
+	while (length < MAX_PLY) {
+		uint64_t moves = b.Moves(b.side);
+		Tt_entry e;
+		int sq;
+		if (moves == 0) {
+			if (b.Moves(-b.side) == 0)
+				break; // game over
+			sq = PASS;
+		}
+		else if (s->table->Probe(b.hash, &e, &tt) && e.move >= 0 && e.move < 64 && (moves & (1ULL << e.move)))
+			sq = e.move;
+		else
+			break;
+		pv += (length > 0 ? "-" : "") + Square_name(sq);
+		b.Make_move(sq);
+		length++;
+	}
+	return pv;
+}
+
+//the reports a protocol search streams: search lines while hinting, status lines while
+//thinking about a move to play
+void Hint_line(Search_stack* s, int depth) {
+	Iteration_stats* it = &s->iterations[depth];
+	char eval[32];
+	snprintf(eval, sizeof(eval), "%.2f", Score_discs(it->score));
+	cout << "search " << Pv_text(s, it) << " " << eval << " 0 " << depth << endl;
+}
+
+void Status_line(Search_stack* s, int depth) {
+	Iteration_stats* it = &s->iterations[depth];
+	char line[100];
+	snprintf(line, sizeof(line), "status depth %d score %.2f nodes %lld time %.2f pv ",
+		depth, Score_discs(it->score), it->nodes, s->iteration_seconds[depth]);
+	cout << line << Pv_text(s, it) << endl;
+}
+
+//searches the position of b with Minimax_decision, or takes the book move, and returns
+//the move with its score in discs. moves in search_stack.root_exclude are left out,
+//and the book with them since its move could be one of them
+int Protocol_search(Bit_Board* b, void (*report)(Search_stack* s, int depth), double* score) {
+	*score = 0;
+	uint64_t moves = b->Moves(b->side);
+	if (moves == 0)
+		return PASS;
+	Board board;
+	board.Set_discs(b->Discs(1), b->Discs(-1));
+	pair<int, int> move;
+	if (search_stack.root_exclude == 0 && Book_move(&board, b->side, &move))
+		return (move.first - 1) * 8 + move.second - 1;
+	search_stack.report = report;
+	search_stack.completed_depth = 0;
+	move = Minimax_decision(&board, b->side);
+	search_stack.report = 0;
+	if (search_stack.completed_depth > 0)
+		*score = Score_discs(search_stack.score);
+	return (move.first - 1) * 8 + move.second - 1;
+}
+
+//drives the engine over stdin and stdout with the nboard protocol, for othello guis
+//and match managers: nboard, set game, set depth, move, hint, go, ping, learn and
+//quit. set position squares side, set time seconds, set nodes n and set threads n
+//are extensions of it. nothing is drawn and nothing waits but the searches
+void Protocol() {
+	Bit_Board game;
+	string line;
+	while (getline(cin, line)) {
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		istringstream in(line);
+		string command;
+		in >> command;
+		if (command.empty())
+			continue;
+		if (command == "nboard")
+			cout << "set myname Othello" << endl;
+		else if (command == "quit")
+			return;
+		else if (command == "ping") {
+			string n;
+			in >> n;
+			cout << "pong " << n << endl;
+		}
+		else if (command == "learn")
+			cout << "learned" << endl;
+		else if (command == "set") {
+			string what;
+			in >> what;
+			string rest;
+			getline(in, rest);
+			if (what == "game") {
+				Bit_Board b;
+				if (Parse_game(rest, &b)) {
+					game.Set_squares(&b);
+					time_manager.New_game();
+				}
+				else
+					cerr << "bad game " << rest << endl;
+			}
+			else if (what == "position") {
+				uint64_t black;
+				uint64_t white;
+				int side = 1;
+				if (Parse_position(rest, &black, &white, &side) && (black & white) == 0)
+					game.Set_discs(side == 1 ? black : white, side == 1 ? white : black, side);
+				else
+					cerr << "bad position " << rest << endl;
+			}
+			else if (what == "depth")
+				search_options.max_depth = min(max(atoi(rest.c_str()), 1), MAX_PLY);
+			else if (what == "time")
+				search_options.move_seconds = max(0.01, atof(rest.c_str()));
+			else if (what == "nodes")
+				search_options.max_nodes = max(atoll(rest.c_str()), 0LL);
+			else if (what == "threads")
+				search_options.threads = max(1, atoi(rest.c_str()));
+			// contempt and anything else this engine has no use for are left alone
+		}
+		else if (command == "move") {
+			string move;
+			in >> move;
+			if (!Protocol_move(&game, Parse_square(move)))
+				cerr << "bad move " << move << endl;
+		}
+		else if (command == "hint") {
+			// the n best moves, each one searched in full with the ones before it
+			// left out of the root. no more than there are legal moves
+			int n;
+			if (!(in >> n))
+				n = 1;
+			n = max(1, min(n, Pop_count(game.Moves(game.side))));
+			cout << "status thinking" << endl;
+			for (int k = 0; k < n; k++) {
+				double score;
+				int sq = Protocol_search(&game, Hint_line, &score);
+				if (search_stack.completed_depth == 0) { // book, pass or the only move
+					char eval[32];
+					snprintf(eval, sizeof(eval), "%.2f", score);
+					cout << "search " << Square_name(sq) << " " << eval << " 0 0" << endl;
+				}
+				if (sq == PASS)
+					break;
+				search_stack.root_exclude |= 1ULL << sq;
+			}
+			search_stack.root_exclude = 0;
+			cout << "status" << endl;
+		}
+		else if (command == "go") {
+			cout << "status thinking" << endl;
+			auto start = chrono::steady_clock::now();
+			double score;
+			int sq = Protocol_search(&game, Status_line, &score);
+			double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			char reply[64];
+			snprintf(reply, sizeof(reply), "=== %s/%.2f/%.2f", Square_name(sq).c_str(), score, seconds);
+			cout << reply << endl;
+			if (search_stack.completed_depth > 0)
+				cout << "nodestats " << search_stack.nodes << " " << seconds << endl;
+			cout << "status" << endl;
+		}
+		else
+			cerr << "unknown command " << command << endl;
+	}
+}
+
+//score of a finished game for the side to move
+int Final_score(Bit_Board* b) {
+	return Diff_score(b->own_count - b->opp_count);
 }
 
-bool Make_smarter_cpu_move(Board* b, int cpuval) {
-	pair<int, int> temp = Minimax_decision(b, cpuval);
-	if (b->Get_square(temp.first, temp.second) == 0) {
-		if (b->Play_square(temp.first, temp.second, cpuval))
-			return true;
-	}
-	cout << "Computer passes." << endl;
-	return false;
+//search score of a game that ends diff discs up
+int Diff_score(int diff) {
+	if (diff > 0)
+		return WIN_SCORE + diff;
+	if (diff < 0)
+		return -WIN_SCORE + diff;
+	return 0;
 }
 
-pair<int, int> Minimax_decision(Board* b, int cpuval) {
-	// returns a pair<int, int> <i, j> for row, column of best move
-	Board* bt = new Board();
-	bt->Set_squares(b);
+// disc difference windows equivalent to a search window: Diff_score(d) > alpha
+// exactly when d > Diff_alpha(alpha), Diff_score(d) < beta exactly when d < Diff_beta(beta)
+int Diff_alpha(int alpha) {
+	if (alpha >= WIN_SCORE)
+		return min(alpha - WIN_SCORE, 64);
+	if (alpha <= -WIN_SCORE)
+		return max(min(alpha + WIN_SCORE, -1), -65);
+	return alpha >= 0 ? 0 : -1;
+}
 
-	int tempval;
+int Diff_beta(int beta) {
+	if (beta >= WIN_SCORE)
+		return min(max(beta - WIN_SCORE, 1), 65);
+	if (beta <= -WIN_SCORE)
+		return max(beta + WIN_SCORE, -64);
+	return beta > 0 ? 1 : 0;
+}
+
+// principal variation search: values are from the side to move's point of view,
+// the first move gets the full window, the others a null window around alpha and
+// a second full search only if they beat it
+int Negamax(Search_stack* s, int alpha, int beta, int depth) {
+	Bit_Board* b = &s->board;
+	Search_frame* f = &s->frames[depth];
+	s->pv_length[depth] = depth;
+
+	if ((++s->nodes & (TIME_CHECK_NODES - 1)) == 0 && Out_of_budget(s))
+		s->timed_out = true;
+	Move_list* moves = &f->moves;
+	b->Legal_moves(moves);
+	if (depth == 0)
+		Exclude_moves(moves, s->root_exclude);
+	if (moves->count == 0)
+		return Final_score(b);
+
+	// close to the end the solver's answer replaces the heuristic, see Minimax_decision
+	if (depth > 0 && s->solving) {
+		int lo = Diff_alpha(alpha);
+		int hi = Diff_beta(beta);
+		if (b->empties > search_options.exact_empties && max(lo, -1) < min(hi, 1)) {
+			lo = max(lo, -1);
+			hi = min(hi, 1);
+		}
+		return Diff_score(Solve_endgame(s, b->own, b->opp, lo, hi));
+	}
 
-	// computer always trying to maximize Eval function
-	// need a number higher than Eval can ever be to treat as initial max val
-	int maxval = 9000;
-	int maxi;
-	int maxj;
+	// reached depth limit or time limit, score the board according to heuristic function
+	if (depth >= s->maxdepth || depth >= MAX_PLY || s->timed_out) {
+		s->eval_calls++;
+		return b->Eval(b->side, depth, s->eval);
+	}
 
-	bool nomove = true;
+	if (moves->mask == 0) { // only the other side can move
+		s->follow_pv = s->follow_pv && depth < s->prev_pv_length && s->prev_pv[depth] == PASS;
+		f->sq = PASS;
+		f->best = PASS;
+		b->Make_move(PASS);
+		int val = -Negamax(s, -beta, -alpha, depth + 1);
+		b->Unmake_move();
+		Update_pv(s, depth);
+		return val;
+	}
 
-	int depth = 0; // iterative deepening
-	// start clock
-	time_t start; time_t now;
-	time(&start);
+	int val;
+	int hash_move;
+	if (Probe_table(s, alpha, beta, depth, &val, &hash_move))
+		return val;
+
+	// off the pv only, where the window is null and a wrong cut costs the least
+	if (beta - alpha == 1 && Try_probcut(s, alpha, beta, depth, &val))
+		return val;
+
+	int orig_alpha = alpha;
+	int best_val = -INF_SCORE;
+	f->best = NO_MOVE;
+	bool on_pv = s->follow_pv;
+	Order_moves(s, depth, hash_move);
+	for (int n = 0; n < moves->count; n++) {
+		f->sq = moves->list[n];
+		s->follow_pv = on_pv && depth < s->prev_pv_length && f->sq == s->prev_pv[depth];
+		b->Make_move(f->sq);
+
+		if (n == 0)
+			val = -Negamax(s, -beta, -alpha, depth + 1);
+		else {
+			val = -Negamax(s, -alpha - 1, -alpha, depth + 1);
+			if (val > alpha && val < beta)
+				val = -Negamax(s, -beta, -alpha, depth + 1);
+		}
 
-	//int temp;
+		b->Unmake_move();
 
-	while (true) {
-		depth++; // increase our depth limit for ID
-
-		for (int i = 1; i < 9; i++) {
-			for (int j = 1; j < 9; j++) {
-				if (bt->Get_square(i, j) == 0) {
-					if (bt->Play_square(i, j, cpuval)) {
-
-						tempval = Max_value(bt, cpuval, 9000, -9000, 1, depth, start); // start alpha at 9000, beta at -9000
-						if (tempval <= maxval) { // found a new minimum max value
-							nomove = false;
-							maxi = i;
-							maxj = j;
-							//temp = depth;
-							maxval = tempval;
-						}
-						bt->Set_squares(b); // either way, erase the play and try next one
-					}
-				}
+		if (val > best_val) {
+			best_val = val;
+			f->best = f->sq;
+			if (val > alpha) {
+				alpha = val;
+				Update_pv(s, depth);
 			}
 		}
-		time(&now);
-		if (difftime(now, start) >= 20)
+		if (alpha >= beta) {
+			Note_cutoff(s, depth, n);
 			break;
-
-		// add a little randomness to throw off other computer who thinks we are playing optimally
-		// by cutting off at a ID depth sometimes
-		//if ( (rand() % 100) <= 3)
-		//	break;
+		}
 	}
+	Store_result(s, orig_alpha, beta, depth, best_val, f->best);
+	return best_val;
+}
 
-	pair<int, int> ret;
+//takes the moves on squares out of moves, keeping the order of the rest. a pass stays
+void Exclude_moves(Move_list* moves, uint64_t squares) {
+	if ((moves->mask & squares) == 0)
+		return;
+	moves->mask &= ~squares;
+	int count = 0;
+	for (int n = 0; n < moves->count; n++)
+		if (!(squares & (1ULL << moves->list[n])))
+			moves->list[count++] = moves->list[n];
+	moves->count = count;
+}
 
+// static order for moves nothing else is known about: corners first, then the
+// edges away from the corners, squares touching a corner last (X-squares lowest)
+static const int square_priority[64] = {
+	8, 1, 6, 5, 5, 6, 1, 8,
+	1, 0, 2, 3, 3, 2, 0, 1,
+	6, 2, 4, 4, 4, 4, 2, 6,
+	5, 3, 4, 0, 0, 4, 3, 5,
+	5, 3, 4, 0, 0, 4, 3, 5,
+	6, 2, 4, 4, 4, 4, 2, 6,
+	1, 0, 2, 3, 3, 2, 0, 1,
+	8, 1, 6, 5, 5, 6, 1, 8
+};
 
-	if (nomove) {
-		nomove = false;
-		maxi = 1; // just return something so comp can pass
-		maxj = 1;
+//sorts the moves of the frame at depth, most promising first: the hash move, the
+//previous iteration's pv move, the killers, then by history and square priority
+void Order_moves(Search_stack* s, int depth, int hash_move) {
+	Move_list* moves = &s->frames[depth].moves;
+	int pv_move = NO_MOVE;
+	if (s->follow_pv && depth < s->prev_pv_length)
+		pv_move = s->prev_pv[depth];
+	int* history = s->history[s->board.side == 1 ? 0 : 1];
+	int keys[MAX_MOVES];
+
+	for (int i = 0; i < moves->count; i++) {
+		int sq = moves->list[i];
+		int key;
+		if (sq == hash_move)
+			key = 1 << 30;
+		else if (sq == pv_move)
+			key = 1 << 29;
+		else if (sq == s->killers[depth][0])
+			key = 1 << 28;
+		else if (sq == s->killers[depth][1])
+			key = 1 << 27;
+		else
+			key = history[sq] * 16 + square_priority[sq];
+
+		// insertion sort in place, equal keys stay in row by row order
+		int n = i;
+		while (n > 0 && keys[n - 1] < key) {
+			keys[n] = keys[n - 1];
+			moves->list[n] = moves->list[n - 1];
+			n--;
+		}
+		keys[n] = key;
+		moves->list[n] = sq;
 	}
+}
 
-	ret.first = maxi;
-	ret.second = maxj;
+//the move being searched at depth caused a cutoff, it was the nth one tried
+void Note_cutoff(Search_stack* s, int depth, int n) {
+	int sq = s->frames[depth].sq;
+	s->cutoffs++;
+	if (n == 0)
+		s->first_move_cutoffs++;
 
-	//printf("%d\t%d\n", depth, temp);
+	if (s->killers[depth][0] != sq) {
+		s->killers[depth][1] = s->killers[depth][0];
+		s->killers[depth][0] = sq;
+	}
 
-	return ret;
+	int* history = s->history[s->board.side == 1 ? 0 : 1];
+	int r = s->maxdepth - depth;
+	history[sq] += r * r;
+	if (history[sq] > (1 << 20)) { // keep the keys of Order_moves below the killers
+		for (int c = 0; c < 2; c++)
+			for (int i = 0; i < 64; i++)
+				s->history[c][i] /= 2;
+	}
 }
 
-int Max_value(Board* b, int cpuval, int alpha, int beta, int depth, int maxdepth, time_t start) {
-	// scoring and heuristics of current board if terminal
-	// 2 ways of being terminal: game is over (usually not the case until endgame)
-	//    or reached depth limit
+//the move being searched at depth is the new best one, so the line from depth
+//becomes that move followed by the line found below it
+void Update_pv(Search_stack* s, int depth) {
+	s->pv[depth][depth] = s->frames[depth].sq;
+	for (int d = depth + 1; d < s->pv_length[depth + 1]; d++)
+		s->pv[depth][d] = s->pv[depth + 1][d];
+	s->pv_length[depth] = max(depth + 1, s->pv_length[depth + 1]);
+}
 
-	// additionally, if time limit of 20 sec is reached just return the heuristic
+//multi-probcut: a search Probcut_shallow plies deep predicts this node's score through
+//the regression fitted for its stage and depth, and the node is cut when the prediction
+//falls outside the window by s->probcut_t standard deviations. both sides of the window
+//are tried, fail high first
+bool Try_probcut(Search_stack* s, int alpha, int beta, int depth, int* val) {
+	int remaining = s->maxdepth - depth;
+	if (s->probcut_t <= 0 || remaining < MPC_MIN_DEPTH || abs(alpha) >= WIN_SCORE || abs(beta) >= WIN_SCORE)
+		return false;
+	int shallow;
+	const Probcut_pair* p = probcut.Get(s->board.empties, remaining, &shallow);
+	if (p == 0)
+		return false;
 
-	// if the game is over and computer wins, return maximum number possible (9000)
-	// if the game is over and player wins, -9000
-	// if tie, 0
-	if (b->Full_board() || (!(b->Has_valid_move(cpuval)) && !(b->Has_valid_move(-1 * cpuval)))) {
-		int score = b->Score();
-		if (score == 0)
-			return 0;
-		else if ((score > 0 && (cpuval == 1)) || (score < 0 && (cpuval == -1)))
-			return 9000;
-		else
-			return -9000;
+	int maxdepth = s->maxdepth;
+	bool follow_pv = s->follow_pv;
+	s->maxdepth = depth + shallow;
+	s->follow_pv = false;
+	double margin = s->probcut_t * p->sigma;
+	bool cut = false;
+	int high = (int)ceil((beta + margin - p->b) / p->a); // shallow scores from here on predict >= beta
+	if (high < WIN_SCORE && Negamax(s, high - 1, high, depth) >= high) {
+		*val = beta;
+		cut = true;
+	}
+	else {
+		int low = (int)floor((alpha - margin - p->b) / p->a);
+		if (low > -WIN_SCORE && Negamax(s, low, low + 1, depth) <= low) {
+			*val = alpha;
+			cut = true;
+		}
 	}
+	s->maxdepth = maxdepth;
+	s->follow_pv = follow_pv;
+	return cut && !s->timed_out;
+}
 
-	// reached depth limit or time limit, score the board according to heuristic function
-	time_t now;
-	time(&now);
-	if (depth == maxdepth || difftime(now, start) >= 20)
-		return b->Eval(cpuval, depth);
+//the root is never cut off here, it has to come up with a move
+bool Probe_table(Search_stack* s, int alpha, int beta, int depth, int* val, int* hash_move) {
+	Tt_entry e;
+	*hash_move = NO_MOVE;
+	if (!s->table->Probe(s->board.hash, &e, &s->tt))
+		return false;
+	*hash_move = e.move;
+	if (depth == 0 || e.depth < s->maxdepth - depth)
+		return false;
+	if (e.bound == BOUND_EXACT
+		|| (e.bound == BOUND_LOWER && e.score >= beta)
+		|| (e.bound == BOUND_UPPER && e.score <= alpha)) {
+		*val = e.score;
+		return true;
+	}
+	return false;
+}
 
-	// maximize the min value of successors
-	int minval = beta;
-	int tempval;
+//alpha and beta are the window the node was searched with
+void Store_result(Search_stack* s, int alpha, int beta, int depth, int val, int move) {
+	if (s->timed_out || (depth == 0 && s->root_exclude != 0)) // a root missing moves is not the position
+		return;
+	int bound = BOUND_EXACT;
+	if (val <= alpha)
+		bound = BOUND_UPPER;
+	else if (val >= beta)
+		bound = BOUND_LOWER;
+	s->table->Store(s->board.hash, s->maxdepth - depth, val, bound, move, &s->tt);
+}
 
-	Board* bt = new Board();
-	bt->Set_squares(b);
+// endgame solver. works on bare own / opp masks and returns the final disc difference
+// for own (empty squares count for nobody, as in Board::Score), fail-soft like Negamax.
 
-	for (int i = 1; i < 9; i++) {
-		for (int j = 1; j < 9; j++) {
-			if (b->Get_square(i, j) == 0) {
-				if (b->Play_square(i, j, -1 * cpuval)) { // since this is the player's turn, change the val
+// the four 4x4 quadrants, for parity: the last move of a region with an odd number of
+// empties tends to be worth more, so moves in odd regions are tried first
+static const uint64_t quadrant_mask[4] = {
+	0x000000000f0f0f0fULL, 0x00000000f0f0f0f0ULL, 0x0f0f0f0f00000000ULL, 0xf0f0f0f000000000ULL
+};
 
-					tempval = Min_value(b, cpuval, alpha, minval, depth + 1, maxdepth, start); // new alpha/beta corresponding, our minval will always be >= beta
-					if (tempval >= minval) { // found a new maximum min value
-						minval = tempval;
-					}
+inline int Quadrant(int sq) {
+	return ((sq >> 5) & 1) * 2 + ((sq >> 2) & 1);
+}
+
+//hash of a solver position. own is always the side to move so no side key is needed,
+//and the mixing keeps it apart from the zobrist keys sharing trans_table. opp goes
+//through the whole mix before meeting own, so no bits of the two masks can cancel
+inline uint64_t Mix(uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	return h ^ (h >> 33);
+}
 
-					b->Set_squares(bt); // either way, erase the play and try next one
+inline uint64_t Hash_masks(uint64_t own, uint64_t opp) {
+	return Mix(own ^ Mix(opp + 0x9e3779b97f4a7c15ULL));
+}
 
-					// alpha-beta pruning
-					if (minval > alpha) {
-						return alpha;
-					}
-				}
-			}
-		}
+//sq is the only empty square left
+int Solve_1(Search_stack* s, uint64_t own, uint64_t opp, int sq) {
+	s->nodes++;
+	int diff = 2 * Pop_count(own) - 63;
+	uint64_t flips = Get_flips(own, opp, sq);
+	if (flips)
+		return diff + 2 * Pop_count(flips) + 1;
+	flips = Get_flips(opp, own, sq);
+	if (flips)
+		return diff - 2 * Pop_count(flips) - 1;
+	return diff;
+}
+
+int Solve_2(Search_stack* s, uint64_t own, uint64_t opp, int alpha, int beta, int sq1, int sq2, bool passed) {
+	s->nodes++;
+	int best = -INF_SCORE;
+	uint64_t flips;
+	if ((flips = Get_flips(own, opp, sq1)) != 0) {
+		best = -Solve_1(s, opp ^ flips, own ^ flips ^ (1ULL << sq1), sq2);
+		if (best >= beta)
+			return best;
+	}
+	if ((flips = Get_flips(own, opp, sq2)) != 0)
+		best = max(best, -Solve_1(s, opp ^ flips, own ^ flips ^ (1ULL << sq2), sq1));
+	if (best == -INF_SCORE) {
+		if (passed)
+			return Pop_count(own) - Pop_count(opp);
+		return -Solve_2(s, opp, own, -beta, -alpha, sq1, sq2, true);
+	}
+	return best;
+}
+
+int Solve_3(Search_stack* s, uint64_t own, uint64_t opp, int alpha, int beta, int sq1, int sq2, int sq3, bool passed) {
+	s->nodes++;
+	int best = -INF_SCORE;
+	uint64_t flips;
+	int v;
+	if ((flips = Get_flips(own, opp, sq1)) != 0) {
+		best = -Solve_2(s, opp ^ flips, own ^ flips ^ (1ULL << sq1), -beta, -alpha, sq2, sq3, false);
+		if (best >= beta)
+			return best;
+		alpha = max(alpha, best);
+	}
+	if ((flips = Get_flips(own, opp, sq2)) != 0) {
+		v = -Solve_2(s, opp ^ flips, own ^ flips ^ (1ULL << sq2), -beta, -alpha, sq1, sq3, false);
+		if (v >= beta)
+			return v;
+		best = max(best, v);
+		alpha = max(alpha, v);
+	}
+	if ((flips = Get_flips(own, opp, sq3)) != 0) {
+		v = -Solve_2(s, opp ^ flips, own ^ flips ^ (1ULL << sq3), -beta, -alpha, sq1, sq2, false);
+		best = max(best, v);
+	}
+	if (best == -INF_SCORE) {
+		if (passed)
+			return Pop_count(own) - Pop_count(opp);
+		return -Solve_3(s, opp, own, -beta, -alpha, sq1, sq2, sq3, true);
+	}
+	return best;
+}
+
+//expects the squares in parity order already, see Solve_endgame
+int Solve_4(Search_stack* s, uint64_t own, uint64_t opp, int alpha, int beta, const int* sq, bool passed) {
+	s->nodes++;
+	int best = -INF_SCORE;
+	for (int i = 0; i < 4; i++) {
+		uint64_t flips = Get_flips(own, opp, sq[i]);
+		if (flips == 0)
+			continue;
+		int r[3]; // the other three, same order
+		for (int j = 0, k = 0; j < 4; j++)
+			if (j != i)
+				r[k++] = sq[j];
+		int v = -Solve_3(s, opp ^ flips, own ^ flips ^ (1ULL << sq[i]), -beta, -alpha, r[0], r[1], r[2], false);
+		if (v >= beta)
+			return v;
+		best = max(best, v);
+		alpha = max(alpha, v);
 	}
-	return minval;
+	if (best == -INF_SCORE) {
+		if (passed)
+			return Pop_count(own) - Pop_count(opp);
+		return -Solve_4(s, opp, own, -beta, -alpha, sq, true);
+	}
+	return best;
 }
 
-int Min_value(Board* b, int cpuval, int alpha, int beta, int depth, int maxdepth, time_t start) {
-	// scoring and heuristics of current board if terminal
+int Solve(Search_stack* s, uint64_t own, uint64_t opp, int alpha, int beta, bool passed) {
+	if ((++s->nodes & (TIME_CHECK_NODES - 1)) == 0 && Out_of_budget(s))
+		s->timed_out = true;
+	if (s->sp != 0 && Split_cancelled(s->sp))
+		s->cancelled = true;
+	if (s->timed_out || s->cancelled)
+		return 0;
+
+	uint64_t empty = ~(own | opp);
+	int n_empty = Pop_count(empty);
+	uint64_t moves = Get_moves(own, opp);
+	if (moves == 0) {
+		if (passed)
+			return Pop_count(own) - Pop_count(opp);
+		return -Solve(s, opp, own, -beta, -alpha, true);
+	}
 
-	// 2 ways of being terminal: game is over  or no more valid moves (usually not the case until endgame)
-	//    or reached depth limit
+	int hash_move = NO_MOVE;
+	uint64_t key = 0;
+	if (n_empty >= SOLVE_TT_EMPTIES) {
+		Tt_entry e;
+		key = Hash_masks(own, opp);
+		if (s->table->Probe(key, &e, &s->tt) && e.depth == SOLVED_DEPTH) {
+			if (e.bound == BOUND_EXACT
+				|| (e.bound == BOUND_LOWER && e.score >= beta)
+				|| (e.bound == BOUND_UPPER && e.score <= alpha))
+				return e.score;
+			hash_move = e.move;
+		}
+	}
 
-	// additionally if time limit reached (20 sec) just ret heuristic scoring
+	// fastest-first: moves leaving the opponent the fewest replies go first, with
+	// parity and the square table breaking ties. near the end parity alone.
+	int parity = 0; // bit q set when quadrant q has an odd number of empties
+	for (int q = 0; q < 4; q++)
+		parity |= (Pop_count(empty & quadrant_mask[q]) & 1) << q;
+	int list[MAX_MOVES];
+	int keys[MAX_MOVES];
+	int count = 0;
+	for (; moves; moves &= moves - 1) {
+		int sq = First_square(moves);
+		int k = ((parity >> Quadrant(sq)) & 1) * 16 + square_priority[sq];
+		if (sq == hash_move)
+			k = 1 << 20;
+		else if (n_empty >= SOLVE_SORT_EMPTIES) {
+			uint64_t flips = Get_flips(own, opp, sq);
+			k -= 64 * Pop_count(Get_moves(opp ^ flips, own ^ flips ^ (1ULL << sq)));
+		}
+		int n = count++;
+		while (n > 0 && keys[n - 1] < k) {
+			keys[n] = keys[n - 1];
+			list[n] = list[n - 1];
+			n--;
+		}
+		keys[n] = k;
+		list[n] = sq;
+	}
 
-	// if the game is over and computer wins, return maximum number possible (9000)
-	// if the game is over and player wins, -9000
-	// if the game is over and nobody wins, score 0
-	if (b->Full_board() || (!(b->Has_valid_move(cpuval)) && !(b->Has_valid_move(-1 * cpuval)))) {
-		int score = b->Score();
-		if (score == 0)
-			return 0;
-		else if ((score > 0 && (cpuval == 1)) || (score < 0 && (cpuval == -1)))
-			return 9000;
-		else
-			return -9000;
+	int orig_alpha = alpha;
+	int best = -INF_SCORE;
+	int best_move = NO_MOVE;
+	for (int n = 0; n < count; n++) {
+		if (n > 0 && search_split && n_empty >= search_options.split_empties && count - n >= 2
+			&& !s->timed_out && !s->cancelled) {
+			best = Solve_split(s, own, opp, alpha, beta, best, &best_move, list + n, count - n);
+			break;
+		}
+		int sq = list[n];
+		uint64_t flips = Get_flips(own, opp, sq);
+		uint64_t child_own = opp ^ flips;
+		uint64_t child_opp = own ^ flips ^ (1ULL << sq);
+		int v;
+		if (n == 0)
+			v = -Solve_endgame(s, child_own, child_opp, -beta, -alpha);
+		else {
+			v = -Solve_endgame(s, child_own, child_opp, -alpha - 1, -alpha);
+			if (v > alpha && v < beta)
+				v = -Solve_endgame(s, child_own, child_opp, -beta, -alpha);
+		}
+		if (v > best) {
+			best = v;
+			best_move = sq;
+			if (v > alpha)
+				alpha = v;
+		}
+		if (alpha >= beta)
+			break;
 	}
 
-	time_t now;
-	time(&now);
-	// reached depth limit, score the board according to heuristic function
-	if (depth == maxdepth || difftime(now, start) >= 20)
-		return b->Eval(cpuval, depth);
+	if (key != 0 && !s->timed_out && !s->cancelled) {
+		int bound = BOUND_EXACT;
+		if (best <= orig_alpha)
+			bound = BOUND_UPPER;
+		else if (best >= beta)
+			bound = BOUND_LOWER;
+		s->table->Store(key, SOLVED_DEPTH, best, bound, best_move, &s->tt);
+	}
+	return best;
+}
 
-	// minimize the max value of successors
-	int maxval = alpha;
-	int tempval;
+//rough seconds a solving iteration takes with empties at the root, from the mean of
+//positions solved on one thread. single positions take up to a few times more
+double Solve_estimate(int empties) {
+	double seconds = SOLVE_SECONDS * pow(SOLVE_GROWTH, empties - 18);
+	if (empties - 1 > search_options.exact_empties)
+		seconds *= SOLVE_WLD_SHARE;
+	return seconds;
+}
 
-	Board* bt = new Board();
-	bt->Set_squares(b);
+//solves own to move with any number of empties, picking the routine for the count
+int Solve_endgame(Search_stack* s, uint64_t own, uint64_t opp, int alpha, int beta) {
+	uint64_t empty = ~(own | opp);
+	int n_empty = Pop_count(empty);
+	if (n_empty > 4)
+		return Solve(s, own, opp, alpha, beta, false);
+	if (n_empty == 0)
+		return Pop_count(own) - Pop_count(opp);
+
+	// odd quadrants first
+	int sq[4];
+	int n = 0;
+	for (int odd = 1; odd >= 0; odd--)
+		for (uint64_t m = empty; m; m &= m - 1) {
+			int e = First_square(m);
+			if ((Pop_count(empty & quadrant_mask[Quadrant(e)]) & 1) == odd)
+				sq[n++] = e;
+		}
+	if (n_empty == 1)
+		return Solve_1(s, own, opp, sq[0]);
+	if (n_empty == 2)
+		return Solve_2(s, own, opp, alpha, beta, sq[0], sq[1], false);
+	if (n_empty == 3)
+		return Solve_3(s, own, opp, alpha, beta, sq[0], sq[1], sq[2], false);
+	return Solve_4(s, own, opp, alpha, beta, sq, false);
+}
 
-	for (int i = 1; i < 9; i++) {
-		for (int j = 1; j < 9; j++) {
-			if (b->Get_square(i, j) == 0) {
-				if (b->Play_square(i, j, cpuval)) {
+// young brothers wait: a solver node searches its first move alone, then puts the
+// others in its thread's work queue and works through them while idle threads steal
+// from the queue. best is the score of the first move, the best move goes to best_move.
+int Solve_split(Search_stack* s, uint64_t own, uint64_t opp, int alpha, int beta, int best, int* best_move, const int* list, int count) {
+	Split_point sp;
+	sp.parent = s->sp;
+	sp.own = own;
+	sp.opp = opp;
+	sp.beta = beta;
+	sp.count = count;
+	for (int n = 0; n < count; n++)
+		sp.list[n] = list[n];
+	sp.alpha = alpha;
+	sp.best = best;
+	sp.best_move = *best_move;
+	sp.cutoff = false;
+	sp.timed_out = false;
+	sp.pending = count;
+
+	Work_queue* q = &work_queues[s->id];
+	q->lock.lock();
+	for (int n = count - 1; n >= 0; n--) // the best ordered move ends up at the back
+		q->tasks.push_back(Solve_task{ &sp, n });
+	q->lock.unlock();
+
+	// take back what is left, then help the threads that stole a move until the
+	// last one is done. helping only below sp keeps this node from waiting on
+	// some unrelated subtree.
+	while (sp.pending > 0) {
+		Solve_task t;
+		bool found = false;
+		q->lock.lock();
+		if (!q->tasks.empty() && q->tasks.back().sp == &sp) {
+			t = q->tasks.back();
+			q->tasks.pop_back();
+			found = true;
+		}
+		q->lock.unlock();
+		if (found || Steal_task(s, &sp, &t))
+			Run_task(s, t);
+		else
+			this_thread::yield();
+	}
 
-					tempval = Max_value(b, cpuval, maxval, beta, depth + 1, maxdepth, start); // our maxval always <= alpha
-					if (tempval <= maxval) { // found a new maximum min value
-						maxval = tempval;
-					}
+	if (sp.timed_out)
+		s->timed_out = true;
+	s->cancelled = s->sp != 0 && Split_cancelled(s->sp);
+	*best_move = sp.best_move;
+	return sp.best;
+}
+
+//whether sp or a split point it works for was cut off
+bool Split_cancelled(Split_point* sp) {
+	for (; sp != 0; sp = sp->parent)
+		if (sp->cutoff)
+			return true;
+	return false;
+}
 
-					b->Set_squares(bt); // either way, erase the play and try next one
+//takes the oldest task of another thread, one working for below if below is not 0
+bool Steal_task(Search_stack* s, Split_point* below, Solve_task* t) {
+	int threads = (int)work_queues.size();
+	for (int i = 1; i < threads; i++) {
+		Work_queue* q = &work_queues[(s->id + i) % threads];
+		q->lock.lock();
+		bool found = false;
+		if (!q->tasks.empty()) {
+			Split_point* sp = q->tasks.front().sp;
+			while (below != 0 && sp != 0 && sp != below)
+				sp = sp->parent;
+			if (sp == below || below == 0) {
+				*t = q->tasks.front();
+				q->tasks.pop_front();
+				found = true;
+			}
+		}
+		q->lock.unlock();
+		if (found)
+			return true;
+	}
+	return false;
+}
 
-					if (maxval < beta) {
-						return beta;
-					}
-				}
+//solves one move of a split point and merges the score into it
+void Run_task(Search_stack* s, Solve_task t) {
+	Split_point* sp = t.sp;
+	Split_point* saved = s->sp;
+	s->sp = sp;
+	s->cancelled = false;
+	if (!Split_cancelled(sp)) {
+		int sq = sp->list[t.n];
+		uint64_t flips = Get_flips(sp->own, sp->opp, sq);
+		uint64_t child_own = sp->opp ^ flips;
+		uint64_t child_opp = sp->own ^ flips ^ (1ULL << sq);
+		sp->lock.lock();
+		int alpha = sp->alpha;
+		sp->lock.unlock();
+		bool searched = alpha < sp->beta; // or a cutoff came after the Split_cancelled above
+		int v = 0;
+		if (searched)
+			v = -Solve_endgame(s, child_own, child_opp, -alpha - 1, -alpha);
+		if (searched && v > alpha && v < sp->beta && !s->timed_out && !s->cancelled) {
+			// v is only a lower bound and other moves may have raised alpha in the
+			// meantime, even past v, so the full search is needed either way
+			sp->lock.lock();
+			alpha = sp->alpha;
+			sp->lock.unlock();
+			if (alpha < sp->beta)
+				v = -Solve_endgame(s, child_own, child_opp, -sp->beta, -alpha);
+		}
+		if (searched && !s->timed_out && !s->cancelled) {
+			sp->lock.lock();
+			if (v > sp->best) {
+				sp->best = v;
+				sp->best_move = sq;
 			}
+			if (v > sp->alpha)
+				sp->alpha = v;
+			if (sp->alpha >= sp->beta)
+				sp->cutoff = true;
+			sp->lock.unlock();
 		}
+		else if (s->timed_out)
+			sp->timed_out = true;
 	}
-	return maxval;
+	s->sp = saved;
+	s->cancelled = false;
+	sp->pending--;
 }
 
 class Multi_Board : public Board {
@@ -540,6 +4469,8 @@ private:
 	int chance2_row;
 	int chance2_col;
 	int check_chance[4];
+	int steal_row; // square Good_chance_second takes without asking, 0 to ask
+	int steal_col;
 
 public:
 	Multi_Board();
@@ -547,7 +4478,7 @@ public:
 	void To_string();
 	void Chance_Placing();
 	void Good_chance(int, int, int);
-	void Good_chance_second(int, int, int);
+	void Good_chance_second(int);
 	void Check_good();
 	void Bad_chance(int, int, int);
 	void Check_bad();
@@ -561,6 +4492,8 @@ public:
 	void Set_squares(Board* b);
 	int Eval(int, int);
 	int Free_neighbors(int, int);
+	void Set_steal(int row, int col); //what the computer takes if its next move draws the steal
+	void Chance_masks(uint64_t* black, uint64_t* white, uint64_t* chance, uint64_t* black_locked, uint64_t* white_locked);
 };
 
 Multi_Board::Multi_Board() {
@@ -584,6 +4517,8 @@ Multi_Board::Multi_Board() {
 	check_chance[1] = 0; // color
 	check_chance[2] = 0; // chance card 2 type (1= good ,2= bad)
 	check_chance[3] = 0; // color 
+	steal_row = 0;
+	steal_col = 0;
 }
 
 void Multi_Board::Mode_select() {
@@ -593,13 +4528,13 @@ void Multi_Board::Mode_select() {
 
 	if (a == "Y" || a == "y") {
 		mode = 1;
-		system("cls");
+		Clear_screen();
 		Go_to_xy(62, 20); cout << "Chance mode selected." << endl;
 		Chance_Placing();
 	}
 	else {
 		mode = 0;
-		system("cls");
+		Clear_screen();
 		Go_to_xy(62, 20); cout << "Normal mode selected." << endl;
 	}
 }
@@ -776,16 +4711,23 @@ void Multi_Board::Good_chance(int row, int col, int color) {
 	}
 }
 
-void Multi_Board::Good_chance_second(int row, int col, int val) {
-	Multi_Board* b = new Multi_Board();
+void Multi_Board::Good_chance_second(int val) {
 	int change_row, change_col;
 	Go_to_xy(62, 30); cout << "Lucky!" << endl;
 	Sleep(1500);
-	Go_to_xy(90, 25); cout << "You can change the color of one of the other player's ball!" << endl;
-	Go_to_xy(90, 26); cout << "Where do you want to set chance card2 row: ";
-	cin >> change_row;
-	Go_to_xy(90, 27); cout << "Where do you want to set chance card1 col: ";
-	cin >> change_col;
+	if (steal_row != 0) {
+		change_row = steal_row;
+		change_col = steal_col;
+		steal_row = 0;
+		steal_col = 0;
+	}
+	else {
+		Go_to_xy(90, 25); cout << "You can change the color of one of the other player's ball!" << endl;
+		Go_to_xy(90, 26); cout << "Where do you want to set chance card2 row: ";
+		cin >> change_row;
+		Go_to_xy(90, 27); cout << "Where do you want to set chance card1 col: ";
+		cin >> change_col;
+	}
 	if (val == -1) {	// white
 		squares[change_row - 1][change_col - 1] = -1;
 	}
@@ -793,8 +4735,8 @@ void Multi_Board::Good_chance_second(int row, int col, int val) {
 		squares[change_row - 1][change_col - 1] = 1;
 	}
 	chances += 27;
-	system("cls");
-	b->To_string();
+	Clear_screen();
+	To_string();
 }
 
 void Multi_Board::Check_good() {
@@ -914,7 +4856,7 @@ bool Multi_Board::Play_square(int row, int col, int val) {
 		else if (random_number == 1)
 			Bad_chance(row, col, val);
 		else if (random_number == 2)
-			Good_chance_second(row, col, val);
+			Good_chance_second(val);
 		else
 		{
 			chances += 1;
@@ -959,7 +4901,7 @@ void Multi_Board::Set_squares(Board* b) {
 	}
 }
 
-int Multi_Board::Eval(int cpuval, int depth) { //multi에선 필요 없을 듯
+int Multi_Board::Eval(int cpuval, int) { //multi에선 필요 없을 듯
 
 	int score = 0; // Evaluation score
 
@@ -1046,11 +4988,423 @@ int Multi_Board::Free_neighbors(int i, int j) {
 
 }
 
+void Multi_Board::Set_steal(int row, int col) {
+	steal_row = row;
+	steal_col = col;
+}
+
+//the board as masks, bit (row - 1) * 8 + (col - 1). chance squares not played yet are
+//empty to the discs, the locked ones are those Check_good / Check_bad keep setting
+void Multi_Board::Chance_masks(uint64_t* black, uint64_t* white, uint64_t* chance, uint64_t* black_locked, uint64_t* white_locked) {
+	*black = *white = *chance = *black_locked = *white_locked = 0;
+	for (int i = 0; i < 8; i++) {
+		for (int j = 0; j < 8; j++) {
+			uint64_t bit = 1ULL << (i * 8 + j);
+			if (squares[i][j] == 1)
+				*black |= bit;
+			else if (squares[i][j] == -1)
+				*white |= bit;
+			else if (squares[i][j] == 2)
+				*chance |= bit;
+		}
+	}
+	for (int k = 0; k < goods; k++)
+		*(good_coor[k * 3 + 2] == 1 ? black_locked : white_locked) |= 1ULL << (good_coor[k * 3] * 8 + good_coor[k * 3 + 1]);
+	for (int k = 0; k < bads; k++)
+		*(bad_coor[k * 3 + 2] == 1 ? black_locked : white_locked) |= 1ULL << (bad_coor[k * 3] * 8 + bad_coor[k * 3 + 1]);
+}
+
+// a chance mode position from the side to move's point of view
+struct Chance_position {
+	uint64_t own, opp;
+	uint64_t chances; // chance squares nobody has played on yet
+	uint64_t own_locked, opp_locked; // squares set back to one side after every move
+	int side; // 1 if black moves, -1 if white
+};
+
+struct Chance_stack {
+	Time_manager* clock;
+	long long nodes;
+	bool timed_out;
+};
+
+//p after the mover plays sq and, if sq is a chance square, draws outcome. a steal
+//takes square steal first, the way Multi_Board::Play_square does before flipping
+void Chance_play(const Chance_position* p, int sq, int outcome, int steal, Chance_position* out) {
+	uint64_t own = p->own, opp = p->opp;
+	uint64_t own_locked = p->own_locked, opp_locked = p->opp_locked;
+	uint64_t bit = 1ULL << sq;
+	if (outcome == CHANCE_STEAL && steal >= 0) {
+		own |= 1ULL << steal;
+		opp &= ~(1ULL << steal);
+	}
+	uint64_t flips = Get_flips(own, opp, sq);
+	own |= flips | bit;
+	opp &= ~flips;
+	if (outcome == CHANCE_GOOD)
+		own_locked |= bit;
+	else if (outcome == CHANCE_BAD)
+		opp_locked |= bit;
+	own = (own & ~opp_locked) | own_locked;
+	opp = (opp & ~own_locked) | opp_locked;
+	out->own = opp;
+	out->opp = own;
+	out->chances = p->chances & ~bit;
+	out->own_locked = opp_locked;
+	out->opp_locked = own_locked;
+	out->side = -p->side;
+}
+
+//heuristic score for the side to move, halved and kept inside CHANCE_WIN so that no
+//position still in play outranks a finished game
+int Chance_eval(const Chance_position* p) {
+	int score = Mask_eval(p->own, p->opp) / 2;
+	return max(-CHANCE_WIN + 1, min(CHANCE_WIN - 1, score));
+}
+
+//score of a finished game for the side to move: past CHANCE_WIN by half EVAL_DISC for
+//each disc of margin, so a bigger win still counts for more
+int Chance_final(const Chance_position* p) {
+	int diff = Pop_count(p->own) - Pop_count(p->opp);
+	if (diff == 0)
+		return 0;
+	return (diff > 0 ? CHANCE_WIN : -CHANCE_WIN) + diff * EVAL_DISC / 2;
+}
+
+//the opponent's disc the mover takes if playing sq draws the steal, the one leaving
+//the best position on a static look. -1 if the opponent has nothing to take
+int Chance_steal(const Chance_position* p, int sq) {
+	int best = -1, best_score = -INF_SCORE;
+	for (uint64_t m = p->opp; m; m &= m - 1) {
+		int steal = First_square(m);
+		Chance_position c;
+		Chance_play(p, sq, CHANCE_STEAL, steal, &c);
+		int score = -Chance_eval(&c);
+		if (score > best_score) {
+			best_score = score;
+			best = steal;
+		}
+	}
+	return best;
+}
+
+int Chance_negamax(Chance_stack* s, const Chance_position* p, int alpha, int beta, int depth);
+
+//average of the chance_outcomes children of playing chance square sq, pruned with
+//star2 then star1 (ballard, 1983). every child lies in [-CHANCE_BOUND, CHANCE_BOUND], so
+//once the children searched so far and the bounds of the rest show the average can't
+//reach into (alpha, beta), the others are left alone. star2 first tries each child's
+//first move only: it bounds the child from above, which is enough for a fail low
+int Chance_node(Chance_stack* s, const Chance_position* p, int sq, int alpha, int beta, int depth) {
+	const int n = CHANCE_OUTCOMES;
+	Chance_position children[CHANCE_OUTCOMES];
+	int steal = Chance_steal(p, sq);
+	for (int k = 0; k < n; k++)
+		Chance_play(p, sq, k, steal, &children[k]);
+
+	int upper[CHANCE_OUTCOMES]; // what each child can score at most
+	for (int k = 0; k < n; k++)
+		upper[k] = CHANCE_BOUND;
+
+	// star2 probing
+	int probed = 0;
+	for (int k = 0; k < n; k++) {
+		int a = n * alpha - probed - CHANCE_BOUND * (n - 1 - k);
+		if (a <= -CHANCE_BOUND || depth <= 1)
+			break;
+		const Chance_position* c = &children[k];
+		uint64_t moves = Get_moves(c->own, c->opp);
+		if (!moves)
+			break;
+		int first = NO_MOVE;
+		for (uint64_t m = moves; m; m &= m - 1)
+			if (first == NO_MOVE || square_priority[First_square(m)] > square_priority[first])
+				first = First_square(m);
+		// the opponent scores at least its first move, so a probe failing high on -a
+		// leaves this child at most a
+		int v;
+		if (c->chances & (1ULL << first))
+			v = Chance_node(s, c, first, -a - 1, -a, depth - 1);
+		else {
+			Chance_position g;
+			Chance_play(c, first, CHANCE_NOTHING, -1, &g);
+			v = -Chance_negamax(s, &g, a, a + 1, depth - 2);
+		}
+		if (s->timed_out)
+			return 0;
+		if (v < -a)
+			break;
+		upper[k] = -v;
+		probed += upper[k];
+	}
+	int rest = 0;
+	for (int k = 0; k < n; k++)
+		rest += upper[k];
+	if (rest <= n * alpha)
+		return alpha;
+
+	// star1
+	int sum = 0;
+	for (int k = 0; k < n; k++) {
+		rest -= upper[k];
+		int a = n * alpha - sum - rest;
+		int b = n * beta - sum + CHANCE_BOUND * (n - 1 - k);
+		int lo = max(a, -CHANCE_BOUND), hi = min(b, CHANCE_BOUND);
+		int v = -Chance_negamax(s, &children[k], -hi, -lo, depth - 1);
+		if (s->timed_out)
+			return 0;
+		if (v <= a)
+			return alpha;
+		if (v >= b)
+			return beta;
+		sum += v;
+	}
+	return sum / n;
+}
+
+//score of playing sq for the side to move in p
+int Chance_move(Chance_stack* s, const Chance_position* p, int sq, int alpha, int beta, int depth) {
+	if (p->chances & (1ULL << sq))
+		return Chance_node(s, p, sq, alpha, beta, depth);
+	Chance_position c;
+	Chance_play(p, sq, CHANCE_NOTHING, -1, &c);
+	return -Chance_negamax(s, &c, -beta, -alpha, depth - 1);
+}
+
+//fail hard alpha-beta over the moves, Chance_node over the outcomes of a chance square.
+//finished games score by Chance_final, chance squares still open counting for nobody
+int Chance_negamax(Chance_stack* s, const Chance_position* p, int alpha, int beta, int depth) {
+	if ((++s->nodes & (TIME_CHECK_NODES - 1)) == 0 && s->clock->Out_of_time())
+		s->timed_out = true;
+	if (s->timed_out)
+		return 0;
+	uint64_t moves = Get_moves(p->own, p->opp);
+	if (!moves) {
+		if (!Get_moves(p->opp, p->own))
+			return Chance_final(p);
+		Chance_position c = *p;
+		c.own = p->opp;
+		c.opp = p->own;
+		c.own_locked = p->opp_locked;
+		c.opp_locked = p->own_locked;
+		c.side = -p->side;
+		return -Chance_negamax(s, &c, -beta, -alpha, depth);
+	}
+	if (depth <= 0)
+		return Chance_eval(p);
+
+	int list[MAX_MOVES];
+	int count = 0;
+	for (uint64_t m = moves; m; m &= m - 1) {
+		int sq = First_square(m);
+		int i = count++;
+		while (i > 0 && square_priority[list[i - 1]] < square_priority[sq]) {
+			list[i] = list[i - 1];
+			i--;
+		}
+		list[i] = sq;
+	}
+	for (int i = 0; i < count; i++) {
+		int v = Chance_move(s, p, list[i], alpha, beta, depth);
+		if (s->timed_out)
+			return 0;
+		if (v > alpha) {
+			alpha = v;
+			if (alpha >= beta)
+				return beta;
+		}
+	}
+	return alpha;
+}
+
+//iterative deepening over the moves of cpuval in chance mode within the move time.
+//*steal is the square to take should the move chosen draw the steal, 0 based
+pair<int, int> Chance_decision(Multi_Board* b, int cpuval, int* steal) {
+	static Chance_stack stack;
+	Chance_stack* s = &stack;
+	uint64_t black, white, chance, black_locked, white_locked;
+	b->Chance_masks(&black, &white, &chance, &black_locked, &white_locked);
+	Chance_position p;
+	p.own = cpuval == 1 ? black : white;
+	p.opp = cpuval == 1 ? white : black;
+	p.chances = chance;
+	p.own_locked = cpuval == 1 ? black_locked : white_locked;
+	p.opp_locked = cpuval == 1 ? white_locked : black_locked;
+	p.side = cpuval;
+
+	int list[MAX_MOVES];
+	int count = 0;
+	for (uint64_t m = Get_moves(p.own, p.opp); m; m &= m - 1)
+		list[count++] = First_square(m);
+	*steal = -1;
+	if (count == 0)
+		return pair<int, int>(1, 1); // just return something so comp can pass
+	int best = list[0];
+	int empties = 64 - Pop_count(p.own | p.opp);
+
+	time_manager.Start_move(empties);
+	s->clock = &time_manager;
+	s->nodes = 0;
+	s->timed_out = false;
+	double took[MAX_PLY + 1] = { 0 };
+	for (int depth = 1; depth <= empties && count > 1; depth++) {
+		double start = time_manager.Elapsed();
+		int alpha = -CHANCE_BOUND - 1;
+		int depth_best = list[0];
+		for (int i = 0; i < count; i++) {
+			int v = Chance_move(s, &p, list[i], alpha, CHANCE_BOUND + 1, depth);
+			if (s->timed_out)
+				break;
+			if (v > alpha) {
+				alpha = v;
+				depth_best = list[i];
+			}
+		}
+		if (s->timed_out)
+			break;
+		best = depth_best;
+		// the best move goes first next time, it makes the window of the others narrow
+		for (int i = 1; i < count; i++)
+			if (list[i] == best)
+				rotate(list, list + i, list + i + 1);
+		took[depth] = time_manager.Elapsed() - start;
+		if (!time_manager.Start_iteration(took[depth], depth > 2 ? took[depth - 2] : 0))
+			break;
+	}
+	time_manager.End_move();
+	*steal = (p.chances & (1ULL << best)) ? Chance_steal(&p, best) : -1;
+	return pair<int, int>(best / 8 + 1, best % 8 + 1);
+}
+
+bool Make_chance_cpu_move(Multi_Board* b, int cpuval) {
+	if (!b->Has_valid_move(cpuval)) {
+		cout << "Computer passes." << endl;
+		return false;
+	}
+	int steal;
+	pair<int, int> move = Chance_decision(b, cpuval, &steal);
+	if (steal >= 0)
+		b->Set_steal(steal / 8 + 1, steal % 8 + 1);
+	b->Play_square(move.first, move.second, cpuval);
+	b->Set_steal(0, 0); // the draw was something else, the next steal asks again
+	b->Check_good();
+	b->Check_bad();
+	return true;
+}
+
+//p searched as plain expectimax, every move and every outcome of a chance square in
+//full, with the same choice of steal as Chance_node. *nodes counts what it visited
+int Chance_expectimax(const Chance_position* p, int depth, long long* nodes) {
+	++*nodes;
+	uint64_t moves = Get_moves(p->own, p->opp);
+	if (!moves) {
+		if (!Get_moves(p->opp, p->own))
+			return Chance_final(p);
+		Chance_position c = *p;
+		c.own = p->opp;
+		c.opp = p->own;
+		c.own_locked = p->opp_locked;
+		c.opp_locked = p->own_locked;
+		c.side = -p->side;
+		return -Chance_expectimax(&c, depth, nodes);
+	}
+	if (depth <= 0)
+		return Chance_eval(p);
+	int best = -INF_SCORE;
+	for (; moves; moves &= moves - 1) {
+		int sq = First_square(moves);
+		int v;
+		if (p->chances & (1ULL << sq)) {
+			int steal = Chance_steal(p, sq);
+			int sum = 0;
+			for (int k = 0; k < CHANCE_OUTCOMES; k++) {
+				Chance_position c;
+				Chance_play(p, sq, k, steal, &c);
+				sum -= Chance_expectimax(&c, depth - 1, nodes);
+			}
+			v = sum / CHANCE_OUTCOMES;
+		}
+		else {
+			Chance_position c;
+			Chance_play(p, sq, CHANCE_NOTHING, -1, &c);
+			v = -Chance_expectimax(&c, depth - 1, nodes);
+		}
+		best = max(best, v);
+	}
+	return best;
+}
+
+//compares Chance_negamax against Chance_expectimax to depth on positions random
+//games reach after two random chance squares were placed, the same ones every run.
+//each position is searched with the full window and with a narrow one around the
+//true score: inside it the score must be exact, outside it only on the right side
+void Chance_check(int positions, int depth) {
+	Chance_stack stack;
+	Chance_stack* s = &stack;
+	Time_manager clock;
+	clock.Start_fixed(1e9);
+	s->clock = &clock;
+	s->nodes = 0;
+	s->timed_out = false;
+	mt19937 gen(20241001);
+	long long full_nodes = 0;
+	long long pruned_nodes = 0;
+	for (int i = 0; i < positions; i++) {
+		Chance_position p;
+		p.own = 0x0000000810000000ULL;
+		p.opp = 0x0000001008000000ULL;
+		p.own_locked = 0;
+		p.opp_locked = 0;
+		p.side = 1;
+		p.chances = 0;
+		while (Pop_count(p.chances) < 2) {
+			uint64_t bit = 1ULL << (gen() % 64);
+			if (!(bit & (p.own | p.opp)))
+				p.chances |= bit;
+		}
+		int plies = 4 + gen() % 30;
+		for (int k = 0; k < plies; k++) {
+			uint64_t moves = Get_moves(p.own, p.opp);
+			if (!moves)
+				break;
+			for (int n = gen() % Pop_count(moves); n > 0; n--)
+				moves &= moves - 1;
+			int sq = First_square(moves);
+			int outcome = (p.chances & (1ULL << sq)) ? gen() % CHANCE_OUTCOMES : CHANCE_NOTHING;
+			Chance_position c;
+			Chance_play(&p, sq, outcome, outcome == CHANCE_STEAL ? Chance_steal(&p, sq) : -1, &c);
+			p = c;
+		}
+
+		int exact = Chance_expectimax(&p, depth, &full_nodes);
+		long long before = s->nodes;
+		int full = Chance_negamax(s, &p, -CHANCE_BOUND - 1, CHANCE_BOUND + 1, depth);
+		pruned_nodes += s->nodes - before;
+		int alpha = exact - 50 + (int)(gen() % 100);
+		int beta = alpha + 1 + (int)(gen() % 60);
+		int narrow = Chance_negamax(s, &p, alpha, beta, depth);
+		if (full != exact || (exact <= alpha && narrow > alpha) || (exact >= beta && narrow < beta)
+			|| (exact > alpha && exact < beta && narrow != exact)) {
+			Bit_Board b;
+			b.Set_discs(p.own, p.opp, p.side);
+			cout << "mismatch in " << Position_string(&b) << " chances" << Square_list(p.chances)
+				<< " locked" << Square_list(p.own_locked | p.opp_locked) << endl
+				<< "  expectimax " << exact << ", full window " << full
+				<< ", window (" << alpha << ", " << beta << ") " << narrow << endl;
+			return;
+		}
+	}
+	cout << positions << " positions to depth " << depth << ": expectimax " << full_nodes
+		<< " nodes, star1/star2 " << pruned_nodes << " nodes" << endl;
+	cout << "Chance_negamax and Chance_expectimax agree" << endl;
+}
+
 void Play_single(int cpuval) {
 	Board* b = new Board();
+	time_manager.New_game();
 	int human_player = -1 * cpuval;
 	int cpu_player = cpuval;
-	system("cls"); // 보드판 출력을 위해 화면 초기화
+	Clear_screen(); // 보드판 출력을 위해 화면 초기화
 	b->To_string();
 	int consecutive_passes = 0;
 
@@ -1065,12 +5419,13 @@ void Play_single(int cpuval) {
 			}
 			else {
 				consecutive_passes = 0;
+				Start_ponder(b, human_player);
 				Go_to_xy(58, 30); cout << "Your move row (1-8): ";
 				cin >> row;
 				Go_to_xy(58, 31); cout << "Your move col (1-8): ";
 				cin >> col;
 				if (!b->Play_square(row, col, human_player)) {
-					system("cls");
+					Clear_screen();
 					b->To_string();
 					Go_to_xy(64, 29); cout << "Illegal move." << endl;
 					continue;
@@ -1080,7 +5435,7 @@ void Play_single(int cpuval) {
 			if (b->Full_board())
 				break;
 			else {
-				system("cls");
+				Clear_screen();
 				b->To_string();
 				Go_to_xy(58, 30); cout << "AI is thinking now, please wait" << endl;
 				//if(Make_simple_cpu_move(b, cpu_player))
@@ -1089,7 +5444,7 @@ void Play_single(int cpuval) {
 					consecutive_passes = 0;
 				else
 					consecutive_passes++;
-				system("cls");
+				Clear_screen();
 				b->To_string();
 			}
 		}
@@ -1107,7 +5462,7 @@ void Play_single(int cpuval) {
 					consecutive_passes = 0;
 				else
 					consecutive_passes++;
-				system("cls");
+				Clear_screen();
 				b->To_string();
 			}
 
@@ -1118,25 +5473,27 @@ void Play_single(int cpuval) {
 			}
 			else {
 				consecutive_passes = 0;
+				Start_ponder(b, human_player);
 				while (true) {
 					Go_to_xy(58, 30); cout << "Your move row (1-8): ";
 					cin >> row;
 					Go_to_xy(58, 31); cout << "Your move col (1-8): ";
 					cin >> col;
 					if (!b->Play_square(row, col, human_player)) {
-						system("cls");
+						Clear_screen();
 						b->To_string();
 						Go_to_xy(62, 29); cout << "Illegal move." << endl;
 					}
 					else
 						break;
 				}
-				system("cls");
+				Clear_screen();
 				b->To_string();
 			}
 		}
 	}
 
+	Stop_ponder(); // the human's last move ended the game
 	int score = b->Score();
 	if (score == 0) {
 		Go_to_xy(58, 30); cout << "Tie game." << endl;
@@ -1150,13 +5507,23 @@ void Play_single(int cpuval) {
 
 	Sleep(3000);
 
+	delete b;
 	return;
 }
 
 void Play_multi(void) {
 	Multi_Board* b = new Multi_Board();
+	time_manager.New_game();
 	b->Mode_select();
-	system("cls");
+	string a;
+	Go_to_xy(62, 26); cout << "Play against the computer? (B: it plays black, W: it plays white, N: no)" << endl;
+	Go_to_xy(62, 27); cin >> a;
+	int cpuval = 0;
+	if (a == "B" || a == "b")
+		cpuval = 1;
+	else if (a == "W" || a == "w")
+		cpuval = -1;
+	Clear_screen();
 	b->To_string();
 	Go_to_xy(62, 18); cout << "Black goes first." << endl;
 
@@ -1171,6 +5538,13 @@ void Play_multi(void) {
 			Go_to_xy(58, 30); cout << "You must pass." << endl;
 			consecutive_passes++;
 		}
+		else if (cpuval == 1) {
+			consecutive_passes = 0;
+			Go_to_xy(58, 31); cout << "AI is thinking now, please wait" << endl;
+			Make_chance_cpu_move(b, 1);
+			Clear_screen();
+			b->To_string();
+		}
 		else {
 			consecutive_passes = 0;
 			Go_to_xy(58, 31); cout << "Your move row (1-8): ";
@@ -1178,7 +5552,7 @@ void Play_multi(void) {
 			Go_to_xy(58, 32); cout << "Your move col (1-8): ";
 			cin >> col;
 			if (!b->Play_square(row, col, 1)) {
-				system("cls");
+				Clear_screen();
 				b->To_string();
 				Go_to_xy(62, 30); cout << "Illegal move." << endl;
 				continue;
@@ -1186,7 +5560,7 @@ void Play_multi(void) {
 
 			b->Check_good();
 			b->Check_bad();
-			system("cls");
+			Clear_screen();
 			b->To_string();
 		}
 
@@ -1196,6 +5570,13 @@ void Play_multi(void) {
 			Go_to_xy(58, 30); cout << "You must pass." << endl;
 			consecutive_passes++;
 		}
+		else if (cpuval == -1) {
+			consecutive_passes = 0;
+			Go_to_xy(58, 31); cout << "AI is thinking now, please wait" << endl;
+			Make_chance_cpu_move(b, -1);
+			Clear_screen();
+			b->To_string();
+		}
 		else {
 			consecutive_passes = 0;
 			while (true) {
@@ -1204,7 +5585,7 @@ void Play_multi(void) {
 				Go_to_xy(58, 32); cout << "Your move col (1-8): ";
 				cin >> col;
 				if (!b->Play_square(row, col, -1)) {
-					system("cls");
+					Clear_screen();
 					b->To_string();
 					Go_to_xy(62, 29); cout << "White's turn" << endl;
 					Go_to_xy(62, 30); cout << "Illegal move." << endl;
@@ -1214,7 +5595,7 @@ void Play_multi(void) {
 			}
 			b->Check_good();
 			b->Check_bad();
-			system("cls");
+			Clear_screen();
 			b->To_string();
 		}
 	}
@@ -1231,6 +5612,7 @@ void Play_multi(void) {
 
 	Sleep(3000);
 
+	delete b;
 	return;
 }
 
@@ -1260,10 +5642,10 @@ void Main_menu() {
 
 
 int Key_control() {
-	int key = _getch();
+	int key = Get_key();
 
 	if (key == 224 || key == 0) {
-		key = _getch();
+		key = Get_key();
 		switch (key) {
 		case 72:
 			return UP;
@@ -1271,9 +5653,18 @@ int Key_control() {
 			return DOWN;
 		}
 	}
-	else if (key == 13 || key == 32) { //엔터 또는 스페이스
+	else if (key == 27 && Get_key() == '[') { // arrow keys of an ansi terminal
+		switch (Get_key()) {
+		case 'A':
+			return UP;
+		case 'B':
+			return DOWN;
+		}
+	}
+	else if (key == 13 || key == 10 || key == 32) { //엔터 또는 스페이스
 		return SELECT;
 	}
+	return NO_KEY;
 }
 
 int Menu_draw() {
@@ -1318,7 +5709,7 @@ int Menu_draw() {
 }
 
 void Info_draw() {
-	system("cls");
+	Clear_screen();
 	cout << "\t\t"; cout << "                                             오셀로 게임                                   \n";
 	cout << "\t\t"; cout << "                        검은 색 또는 하얀 색 작은 원판을 8x8의 판 위에 늘어 놓는 게임      \n\n\n\n";
 	cout << "\t\t"; cout << "                                                [규칙]                                     \n";
@@ -1338,7 +5729,7 @@ void Info_draw() {
 }
 
 void Playgame() {
-	system("cls");
+	Clear_screen();
 	char a;
 	char re = 'Y';
 
@@ -1347,20 +5738,20 @@ void Playgame() {
 		Go_to_xy(62, 21); cin >> a;
 
 		while (a != 'Y' && a != 'y' && a != 'N' && a != 'n') {
-			system("cls");
+			Clear_screen();
 			Go_to_xy(62, 20); cout << "Type Y or N." << endl;
 			Go_to_xy(62, 21); cout << "Single play? (Y/N)" << endl;
 			Go_to_xy(62, 22);  cin >> a;
 		}
 
 		if (a == 'Y' || a == 'y') {
-			system("cls");
+			Clear_screen();
 			Go_to_xy(62, 20); cout << "Single play mode selected." << endl;
 			Go_to_xy(62, 21); cout << "Do you want to go first?" << endl;
 			Go_to_xy(62, 22); cin >> a;
 
 			while (a != 'Y' && a != 'y' && a != 'N' && a != 'n') {
-				system("cls");
+				Clear_screen();
 				Go_to_xy(62, 20); cout << "Type Y or N." << endl;
 				Go_to_xy(62, 21); cout << "Do you want to go first? (Y/N)" << endl;
 				Go_to_xy(62, 22); cin >> a;
@@ -1376,23 +5767,162 @@ void Playgame() {
 			}
 		}
 		else {
-			system("cls");
+			Clear_screen();
 			Go_to_xy(62, 20); cout << "Multi play mode selected." << endl;
 			Play_multi();
 		}
-		system("cls");
+		Clear_screen();
 		Go_to_xy(62, 20); cout << "Re? (Y/N)" << endl;
 		Go_to_xy(62, 21); cin >> re;
-		system("cls");
+		Clear_screen();
 	}
 
 
 }
 
+//how many of the arguments from argv[i] on are numbers, so optional numbers on the
+//command line are not taken from the next flag or file name
+int Number_args(int argc, char* argv[], int i) {
+	int n = 0;
+	for (; i + n < argc; n++) {
+		char* end;
+		strtod(argv[i + n], &end);
+		if (end == argv[i + n] || *end != 0)
+			break;
+	}
+	return n;
+}
+
 int main(int argc, char* argv[])
 {
+	// Othello [-threads n] [-move-time seconds] [-game-time seconds] [-weights file] [-ponder]
+	//         [-smp-report depth positions]
+	//         [-self-play samples games depth random_moves] [-tune samples weights epochs]
+	//         [-book file] [-build-book file plies depth] [-depth n] [-analyze positions]
+	//         [-perft depth [squares side]] [-perft-check depth [squares side]]
+	//         [-bench positions [json_file]] [-search-stats] [-search-log file]
+	//         [-openings file] [-match games engine_a engine_b [elo0 elo1]] [-nboard]
+	//         [-probcut t] [-probcut-file file] [-fit-probcut samples positions depth file]
+	//         [-chance-check [positions [depth]]]
+	pattern_eval.Load(DEFAULT_WEIGHTS_FILE); // without one the hand made Eval plays
+	opening_book.Use_file(DEFAULT_BOOK_FILE); // without one every move is searched
+	probcut.Load(DEFAULT_PROBCUT_FILE); // without one every node is searched full width
+	bool threads_given = false;
+	const char* openings_path = 0;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "-weights" && i + 1 < argc) {
+			if (!pattern_eval.Load(argv[++i])) {
+				cerr << "could not read weights from " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (arg == "-threads" && i + 1 < argc) {
+			search_options.threads = max(1, atoi(argv[++i]));
+			threads_given = true;
+		}
+		else if (arg == "-nboard") {
+			Protocol();
+			return 0;
+		}
+		else if (arg == "-openings" && i + 1 < argc)
+			openings_path = argv[++i];
+		else if (arg == "-match" && i + 3 < argc) {
+			if (!threads_given)
+				search_options.threads = max((int)thread::hardware_concurrency(), 1);
+			bool sprt = Number_args(argc, argv, i + 4) >= 2;
+			Match(max(atoi(argv[i + 1]), 1), argv[i + 2], argv[i + 3], sprt, sprt ? atof(argv[i + 4]) : 0, sprt ? atof(argv[i + 5]) : 0, openings_path);
+			return 0;
+		}
+		else if (arg == "-search-stats")
+			search_stats = true;
+		else if (arg == "-search-log" && i + 1 < argc) {
+			search_log.open(argv[++i], ios::app);
+			if (!search_log) {
+				cerr << "could not open " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (arg == "-depth" && i + 1 < argc)
+			search_options.max_depth = min(max(atoi(argv[++i]), 1), MAX_PLY);
+		else if (arg == "-move-time" && i + 1 < argc)
+			search_options.move_seconds = max(0.01, atof(argv[++i]));
+		else if (arg == "-game-time" && i + 1 < argc)
+			search_options.game_seconds = max(0.0, atof(argv[++i]));
+		else if (arg == "-probcut" && i + 1 < argc)
+			search_options.probcut_t = max(0.0, atof(argv[++i]));
+		else if (arg == "-probcut-file" && i + 1 < argc) {
+			if (!probcut.Load(argv[++i])) {
+				cerr << "could not read probcut parameters from " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (arg == "-fit-probcut" && i + 4 < argc) {
+			Fit_probcut(argv[i + 1], max(atoi(argv[i + 2]), 1), min(max(atoi(argv[i + 3]), MPC_MIN_DEPTH), MPC_MAX_DEPTH), argv[i + 4]);
+			return 0;
+		}
+		else if (arg == "-ponder")
+			search_options.ponder = true;
+		else if (arg == "-smp-report") {
+			int numbers = Number_args(argc, argv, i + 1);
+			int depth = numbers > 0 ? atoi(argv[i + 1]) : 10;
+			int positions = numbers > 1 ? atoi(argv[i + 2]) : 8;
+			Smp_report(max(search_options.threads, 2), min(max(depth, 1), MAX_PLY), max(positions, 1));
+			return 0;
+		}
+		else if (arg == "-self-play" && i + 1 < argc) {
+			int numbers = Number_args(argc, argv, i + 2);
+			int games = numbers > 0 ? atoi(argv[i + 2]) : 1000;
+			int depth = numbers > 1 ? atoi(argv[i + 3]) : 4;
+			int random_moves = numbers > 2 ? atoi(argv[i + 4]) : 10;
+			Self_play(argv[i + 1], max(games, 1), min(max(depth, 1), MAX_PLY), max(random_moves, 0));
+			return 0;
+		}
+		else if (arg == "-analyze" && i + 1 < argc) {
+			// every core unless told otherwise, each on positions of its own
+			Analyze(argv[i + 1], threads_given ? search_options.threads : max((int)thread::hardware_concurrency(), 1));
+			return 0;
+		}
+		else if ((arg == "-perft" || arg == "-perft-check") && i + 1 < argc) {
+			string position = i + 2 < argc ? argv[i + 2] : ""; // squares and side as one argument or two
+			if (i + 3 < argc)
+				position += string(" ") + argv[i + 3];
+			Perft_report(max(atoi(argv[i + 1]), 1), position.empty() ? 0 : position.c_str(), arg == "-perft-check");
+			return 0;
+		}
+		else if (arg == "-chance-check") {
+			int numbers = Number_args(argc, argv, i + 1);
+			int positions = numbers > 0 ? atoi(argv[i + 1]) : 300;
+			int depth = numbers > 1 ? atoi(argv[i + 2]) : 4;
+			Chance_check(max(positions, 1), min(max(depth, 1), MAX_PLY));
+			return 0;
+		}
+		else if (arg == "-bench") {
+			int numbers = Number_args(argc, argv, i + 1);
+			int positions = numbers > 0 ? atoi(argv[i + 1]) : 1000;
+			bool json = numbers > 0 && i + 2 < argc && argv[i + 2][0] != '-'; // a file name, not the next flag
+			Bench_report(max(positions, 1), json ? argv[i + 2] : 0);
+			return 0;
+		}
+		else if (arg == "-book" && i + 1 < argc)
+			opening_book.Use_file(argv[++i]);
+		else if (arg == "-build-book" && i + 1 < argc) {
+			int numbers = Number_args(argc, argv, i + 2);
+			int plies = numbers > 0 ? atoi(argv[i + 2]) : 8;
+			int depth = numbers > 1 ? atoi(argv[i + 3]) : 10;
+			Build_book(argv[i + 1], min(max(plies, 1), 60), min(max(depth, 1), MAX_PLY));
+			return 0;
+		}
+		else if (arg == "-tune" && i + 2 < argc) {
+			int epochs = Number_args(argc, argv, i + 3) > 0 ? atoi(argv[i + 3]) : 30;
+			Tune(argv[i + 1], argv[i + 2], max(epochs, 1));
+			return 0;
+		}
+	}
 
+#ifdef _WIN32
 	system("mode con cols=150 lines=50 | title 오셀로 게임"); // 콘솔창 크기 및 제목 설정
+#endif
 	while (1) {
 		Main_menu(); // 메인 메뉴 그리기 생성자 호출
 		int menu_code = Menu_draw();
@@ -1406,7 +5936,7 @@ int main(int argc, char* argv[])
 		if (menu_code == 2) {
 			return 0;
 		}
-		system("cls");
+		Clear_screen();
 	}
 	return 0;
 }